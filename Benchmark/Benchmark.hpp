@@ -0,0 +1,325 @@
+#ifndef __BENCHMARK_HPP__
+#define __BENCHMARK_HPP__
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+// Minimal microbenchmark harness shared by the per-module benchmark programs.
+//
+//     int main(int argc, char const* argv[]) {
+//         auto suite = bench::Suite{"scopeguard", argc, argv};
+//         suite.add("MakeScopeGuard", [] { auto g = MakeScopeGuard([] {}); });
+//         return suite.run();
+//     }
+//
+// Every benchmark is calibrated to a batch of iterations lasting --min-time,
+// run --warmup times untimed, then --repetitions times. The summary is per
+// operation (ns), --json writes it to a file and --baseline compares with
+// such a file, failing the run when a benchmark regressed.
+//
+// The gate compares the fastest repetition, which is far less sensitive to
+// scheduling noise than the median. A benchmark regressed when its min grew by
+// more than --threshold percent (default 10) and by more than --noise-floor ns
+// (default 1), and no repetition of the run was as fast as the slowest one of
+// the baseline. The spread between whole runs is much larger than between the
+// repetitions of one run, so without that last check back-to-back runs of an
+// unchanged tree fail. Use --repetitions=30 or more for both runs.
+//
+// One program per module, see CMakeLists.txt:
+//     ./bench_process --repetitions=30 --json=base.json       # on the reference tree
+//     ./bench_process --repetitions=30 --baseline=base.json   # on the change
+//
+// Doesn't include <cmath>, its global ::log would clash with the Logger's namespace.
+namespace bench {
+    template <typename T> inline void doNotOptimize(T const& value) {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    inline void clobberMemory() {
+        asm volatile("" : : : "memory");
+    }
+
+    struct Stats {
+        double min = 0;
+        double median = 0;
+        double mean = 0;
+        double stddev = 0;
+        double max = 0;
+    };
+
+    struct Result {
+        std::string name;
+        std::uint64_t iterations = 0; // per repetition
+        std::size_t repetitions = 0;
+        Stats nsPerOp;
+    };
+
+    inline Stats summarize(std::vector<double> samples) {
+        auto stats = Stats{};
+        if (samples.empty())
+            return stats;
+
+        std::sort(samples.begin(), samples.end());
+        auto n = samples.size();
+        stats.min = samples.front();
+        stats.max = samples.back();
+        stats.median = n % 2 == 1 ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+        for (auto s : samples)
+            stats.mean += s;
+        stats.mean /= static_cast<double>(n);
+        for (auto s : samples)
+            stats.stddev += (s - stats.mean) * (s - stats.mean);
+        stats.stddev = n > 1 ? __builtin_sqrt(stats.stddev / static_cast<double>(n - 1)) : 0.0;
+        return stats;
+    }
+
+    // Discards what the code under test prints to std::cout, out() still
+    // writes to stdout: give it to Suite::setOutput(). std::cout gets its
+    // buffer back when the guard goes, exceptions included.
+    //
+    //     auto silenced = bench::SilenceStdout{};
+    //     auto suite = bench::Suite{"statemachine", argc, argv};
+    //     suite.setOutput(silenced.out());
+    class SilenceStdout {
+        public:
+            SilenceStdout() : original{std::cout.rdbuf(&this->null)}, report{this->original} {}
+            ~SilenceStdout() { std::cout.rdbuf(this->original); }
+
+            SilenceStdout(SilenceStdout const&) = delete;
+            SilenceStdout& operator=(SilenceStdout const&) = delete;
+
+            std::ostream& out() { return this->report; }
+
+        private:
+            // stateless, safe to write to from any thread
+            struct NullBuffer : std::streambuf {
+                int overflow(int c) override { return c; }
+                std::streamsize xsputn(char const*, std::streamsize n) override { return n; }
+            };
+
+            NullBuffer null;
+            std::streambuf* original;
+            std::ostream report;
+    };
+
+    class Suite {
+        public:
+            Suite(std::string name, int argc, char const* argv[]) : name{std::move(name)} {
+                for (int i = 1; i < argc; i++)
+                    this->parse(argv[i]);
+            }
+
+            // `op` is one operation; batched ops amortize the clock reads
+            void add(std::string name, std::function<void()> op) {
+                this->benchmarks.push_back({std::move(name), std::move(op), 0, {}, {}});
+            }
+
+            // fixed iteration count, for operations too slow or stateful to calibrate
+            void add(std::string name, std::uint64_t iterations, std::function<void()> op) {
+                this->benchmarks.push_back({std::move(name), std::move(op), iterations, {}, {}});
+            }
+
+            // setUp/tearDown run once around all batches of the benchmark, untimed
+            void add(std::string name, std::function<void()> setUp, std::function<void()> op,
+                    std::function<void()> tearDown) {
+                this->benchmarks.push_back({std::move(name), std::move(op), 0, std::move(setUp), std::move(tearDown)});
+            }
+
+            // where the tables go, for benchmarks that redirect std::cout
+            void setOutput(std::ostream& out) { this->out = &out; }
+
+            // returns the process exit code: 1 when a benchmark regressed against the baseline
+            int run() {
+                auto& out = *this->out;
+                auto results = std::vector<Result>{};
+                out << std::left << std::setw(40) << this->name << std::right << std::setw(12) << "iterations"
+                    << std::setw(12) << "min ns" << std::setw(12) << "median ns" << std::setw(12) << "mean ns"
+                    << std::setw(10) << "stddev" << "\n";
+
+                for (auto& benchmark : this->benchmarks) {
+                    if (!this->filter.empty() && benchmark.name.find(this->filter) == std::string::npos)
+                        continue;
+
+                    auto result = this->measure(benchmark);
+                    out << std::left << std::setw(40) << result.name << std::right << std::setw(12)
+                        << result.iterations << std::fixed << std::setprecision(2)
+                        << std::setw(12) << result.nsPerOp.min << std::setw(12) << result.nsPerOp.median
+                        << std::setw(12) << result.nsPerOp.mean << std::setw(10) << result.nsPerOp.stddev << "\n";
+                    out.flush();
+                    results.push_back(result);
+                }
+
+                if (!this->jsonPath.empty())
+                    this->writeJson(results);
+                return this->baselinePath.empty() ? 0 : this->compare(results);
+            }
+
+        private:
+            struct Benchmark {
+                std::string name;
+                std::function<void()> op;
+                std::uint64_t iterations;
+                std::function<void()> setUp;
+                std::function<void()> tearDown;
+            };
+
+            void parse(std::string const& arg) {
+                auto value = [&arg](char const* option) -> char const* {
+                    auto size = std::char_traits<char>::length(option);
+                    return arg.compare(0, size, option) == 0 ? arg.c_str() + size : nullptr;
+                };
+
+                if (auto v = value("--repetitions="))
+                    this->repetitions = std::max(1ul, std::strtoul(v, nullptr, 10));
+                else if (auto v = value("--warmup="))
+                    this->warmup = std::strtoul(v, nullptr, 10);
+                else if (auto v = value("--min-time="))
+                    this->minTime = std::chrono::milliseconds(std::strtoul(v, nullptr, 10));
+                else if (auto v = value("--filter="))
+                    this->filter = v;
+                else if (auto v = value("--json="))
+                    this->jsonPath = v;
+                else if (auto v = value("--baseline="))
+                    this->baselinePath = v;
+                else if (auto v = value("--threshold="))
+                    this->threshold = std::strtod(v, nullptr);
+                else if (auto v = value("--noise-floor="))
+                    this->noiseFloor = std::strtod(v, nullptr);
+                else {
+                    // a mistyped option would run the whole suite against the gate
+                    std::cerr << "unknown option " << arg << "\n"
+                        "usage: [--repetitions=N] [--warmup=N] [--min-time=MS] [--filter=TEXT] "
+                        "[--json=FILE] [--baseline=FILE] [--threshold=PERCENT] [--noise-floor=NS]\n";
+                    std::exit(2);
+                }
+            }
+
+            static double timeBatch(Benchmark& benchmark, std::uint64_t iterations) {
+                auto start = std::chrono::steady_clock::now();
+                for (std::uint64_t i = 0; i < iterations; i++)
+                    benchmark.op();
+                return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            }
+
+            Result measure(Benchmark& benchmark) {
+                if (benchmark.setUp)
+                    benchmark.setUp();
+
+                // the first call pays for lazy initialization (TSC calibration, thread buffers)
+                benchmark.op();
+
+                auto iterations = benchmark.iterations;
+                if (iterations == 0) {
+                    auto target = std::chrono::duration<double, std::nano>(this->minTime).count();
+                    iterations = 1;
+                    while (true) {
+                        auto elapsed = timeBatch(benchmark, iterations);
+                        if (elapsed >= target || iterations >= (std::uint64_t{1} << 32))
+                            break;
+                        auto scale = elapsed <= 0 ? 10.0 : std::min(10.0, 1.2 * target / elapsed);
+                        iterations = std::max(iterations + 1, static_cast<std::uint64_t>(iterations * scale));
+                    }
+                }
+
+                for (std::size_t i = 0; i < this->warmup; i++)
+                    timeBatch(benchmark, iterations);
+
+                auto samples = std::vector<double>{};
+                for (std::size_t i = 0; i < this->repetitions; i++)
+                    samples.push_back(timeBatch(benchmark, iterations) / static_cast<double>(iterations));
+
+                if (benchmark.tearDown)
+                    benchmark.tearDown();
+
+                return {benchmark.name, iterations, this->repetitions, summarize(samples)};
+            }
+
+            void writeJson(std::vector<Result> const& results) const {
+                auto out = std::ofstream{this->jsonPath};
+                out << std::setprecision(17) << "{\n  \"suite\": \"" << this->name << "\",\n  \"benchmarks\": [";
+                for (std::size_t i = 0; i < results.size(); i++) {
+                    auto const& r = results[i];
+                    out << (i == 0 ? "\n" : ",\n") << "    {\"name\": \"" << r.name << "\", \"iterations\": "
+                        << r.iterations << ", \"repetitions\": " << r.repetitions << ", \"ns_per_op\": {\"min\": "
+                        << r.nsPerOp.min << ", \"median\": " << r.nsPerOp.median << ", \"mean\": "
+                        << r.nsPerOp.mean << ", \"stddev\": " << r.nsPerOp.stddev << ", \"max\": "
+                        << r.nsPerOp.max << "}}";
+                }
+                out << "\n  ]\n}\n";
+                if (!out)
+                    std::cerr << "couldn't write " << this->jsonPath << "\n";
+            }
+
+            // reads back what writeJson() produced: name -> ns per op, only min and max are set
+            static std::map<std::string, Stats> readBaseline(std::string const& path) {
+                auto in = std::ifstream{path};
+                auto text = std::string{std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+                auto baseline = std::map<std::string, Stats>{};
+
+                auto pos = std::size_t{0};
+                while ((pos = text.find("{\"name\": \"", pos)) != std::string::npos) {
+                    pos += 10;
+                    auto end = text.find('"', pos);
+                    auto min = text.find("\"min\": ", end);
+                    auto max = text.find("\"max\": ", end);
+                    if (end == std::string::npos || min == std::string::npos || max == std::string::npos)
+                        break;
+                    auto& stats = baseline[text.substr(pos, end - pos)];
+                    stats.min = std::strtod(text.c_str() + min + 7, nullptr);
+                    stats.max = std::strtod(text.c_str() + max + 7, nullptr);
+                    pos = max;
+                }
+                return baseline;
+            }
+
+            int compare(std::vector<Result> const& results) const {
+                auto baseline = readBaseline(this->baselinePath);
+                if (baseline.empty()) {
+                    std::cerr << "no benchmarks in baseline " << this->baselinePath << "\n";
+                    return 1;
+                }
+
+                auto& out = *this->out;
+                auto regressions = 0;
+                out << std::defaultfloat << "\nmin ns compared with " << this->baselinePath << " (threshold "
+                    << this->threshold << "%, noise floor " << this->noiseFloor << " ns)\n";
+                for (auto const& r : results) {
+                    auto it = baseline.find(r.name);
+                    if (it == baseline.end() || it->second.min <= 0)
+                        continue;
+                    auto delta = r.nsPerOp.min - it->second.min;
+                    auto change = delta / it->second.min * 100.0;
+                    auto regressed = change > this->threshold && delta > this->noiseFloor
+                        && r.nsPerOp.min > it->second.max;
+                    regressions += regressed;
+                    out << std::left << std::setw(40) << r.name << std::right << std::showpos << std::fixed
+                        << std::setprecision(1) << std::setw(8) << change << "%" << std::noshowpos
+                        << (regressed ? "  REGRESSION" : "") << "\n";
+                }
+                return regressions == 0 ? 0 : 1;
+            }
+
+            std::string name;
+            std::vector<Benchmark> benchmarks;
+            std::size_t repetitions = 10;
+            std::size_t warmup = 2;
+            std::chrono::milliseconds minTime{50};
+            std::string filter;
+            std::string jsonPath;
+            std::string baselinePath;
+            double threshold = 10.0;
+            double noiseFloor = 1.0;
+            std::ostream* out = &std::cout;
+    };
+}
+
+#endif //__BENCHMARK_HPP__
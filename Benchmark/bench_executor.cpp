@@ -0,0 +1,69 @@
+#include <iostream>
+#include <map>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Benchmark.hpp"
+#include "../StateMachine/Executor.hpp"
+
+// A skewed population on 1 to N workers, N the hardware threads: a few
+// machines loop for long, most end in a couple of steps, and all of them are
+// homed on worker 0 so the others only get work by stealing it. An op is the
+// whole population run to its end, the per-worker counters of the last op
+// are printed after the table. What the failure action prints is discarded
+// by bench::SilenceStdout.
+namespace {
+    constexpr auto POPULATION = std::size_t{20000};
+
+    // zipf-like: machine i loops 20000 / (i + 1) times
+    constexpr int loops(std::size_t machine) {
+        return 1 + static_cast<int>(20000 / (machine + 1));
+    }
+
+    std::vector<std::size_t> workerCounts() {
+        auto most = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+        auto counts = std::vector<std::size_t>{};
+        for (std::size_t workers = 1; workers < most; workers *= 2)
+            counts.push_back(workers);
+        counts.push_back(most);
+        return counts;
+    }
+}
+
+int main(int argc, char const* argv[]) {
+    auto silenced = bench::SilenceStdout{};
+    auto suite = bench::Suite{"executor", argc, argv};
+    auto& report = silenced.out();
+    suite.setOutput(report);
+
+    auto last = std::map<std::size_t, std::vector<Executor::Counters>>{};
+    for (auto workers : workerCounts()) {
+        suite.add("skewed 20000 machines, " + std::to_string(workers) + " workers", [workers, &last] {
+            auto executor = Executor{workers};
+            for (std::size_t machine = 0; machine < POPULATION; machine++)
+                executor.add(Machine{State::S_START_MACHINE, Transition::T_DEFAULT, loops(machine)}, 0);
+            for (std::size_t machine = 0; machine < POPULATION; machine++)
+                executor.post(machine, Transition::T_DEFAULT);
+            executor.wait();
+
+            auto& counters = last[workers];
+            counters.clear();
+            for (std::size_t worker = 0; worker < workers; worker++)
+                counters.push_back(executor.counters(worker));
+        });
+    }
+
+    auto code = suite.run();
+    for (auto& [workers, counters] : last) {
+        report << "\n" << workers << " workers:\n";
+        for (std::size_t worker = 0; worker < counters.size(); worker++) {
+            auto& c = counters[worker];
+            report << "  worker " << worker << ": " << c.events << " events, " << c.runs << " runs, " << c.steals
+                << " steals of " << c.stealAttempts << " attempts, steal rate " << c.stealRate() * 100
+                << "%, deque depth " << c.depth << " (max " << c.maxDepth << ")\n";
+        }
+    }
+    return code;
+}
@@ -0,0 +1,133 @@
+#include <cerrno>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "Benchmark.hpp"
+#include "../ErrorHandling/Expected.hpp"
+
+// the same parse-like operation reporting failure through a return code and
+// through Expected<T>, the callee is kept out of line so the result really
+// crosses a call boundary. In release builds Expected<int> must cost what a
+// {value, error} pair costs: same size, returned in registers.
+#ifdef NDEBUG
+static_assert(std::is_trivially_copyable<Expected<int>>::value, "Expected<int> isn't returned in registers");
+static_assert(std::is_trivially_copyable<Expected<void>>::value, "Expected<void> isn't returned in registers");
+static_assert(sizeof(Expected<int>) == sizeof(std::pair<int, ErrorCode>), "Expected<int> is larger than its parts");
+static_assert(sizeof(Expected<void>) == sizeof(std::pair<ErrorCode, ErrorContext::Handle>), "Expected<void> is larger than its parts");
+#endif
+
+namespace {
+    struct RawResult {
+        int value;
+        ErrorCode error;
+    };
+    __attribute__((noinline)) int rawParse(int input, int& output) {
+        if (input < 0)
+            return -1;
+        output = input * 2;
+        return 0;
+    }
+
+    __attribute__((noinline)) RawResult rawPair(int input) {
+        if (input < 0)
+            return {0, ErrorCode::EC_INVALID_INPUT};
+        return {input * 2, ErrorCode::NO_ERROR};
+    }
+
+    __attribute__((noinline)) Expected<int> expectedParse(int input) {
+        if (input < 0)
+            return MakeUnexpected(ErrorCode::EC_INVALID_INPUT);
+        return input * 2;
+    }
+
+    __attribute__((noinline)) Expected<int> expectedParseWithContext(int input) {
+        if (input < 0)
+            return MakeUnexpected(ErrorCode::EC_INVALID_INPUT, "negative input", input);
+        return input * 2;
+    }
+
+    __attribute__((noinline)) Expected<void> expectedCheck(int input) {
+        if (input < 0)
+            return MakeUnexpected(ErrorCode::EC_INVALID_INPUT);
+        return ErrorCode::NO_ERROR;
+    }
+
+    __attribute__((noinline)) Expected<std::string> expectedString(int input) {
+        if (input < 0)
+            return MakeUnexpected(ErrorCode::EC_INVALID_INPUT);
+        return std::string{"a string past the small buffer size"};
+    }
+}
+
+int main(int argc, char const* argv[]) {
+    auto suite = bench::Suite{"expected", argc, argv};
+    auto input = 21;
+    auto failing = -1;
+
+    suite.add("raw return code", [&input] {
+        auto output = 0;
+        auto error = rawParse(input, output);
+        bench::doNotOptimize(error);
+        bench::doNotOptimize(output);
+    });
+
+    suite.add("raw return code (error)", [&failing] {
+        auto output = 0;
+        bench::doNotOptimize(rawParse(failing, output));
+    });
+
+    suite.add("raw {value, error} return", [&input] {
+        auto result = rawPair(input);
+        if (result.error == ErrorCode::NO_ERROR)
+            bench::doNotOptimize(result.value);
+    });
+
+    suite.add("Expected<int> construct+check", [&input] {
+        auto result = expectedParse(input);
+        if (result.getError() == ErrorCode::NO_ERROR)
+            bench::doNotOptimize(result.get());
+    });
+
+    suite.add("Expected<int> construct+check (error)", [&failing] {
+        auto result = expectedParse(failing);
+        bench::doNotOptimize(result.getError());
+    });
+
+    suite.add("Expected<int> with context (error)", [&failing] {
+        auto result = expectedParseWithContext(failing);
+        bench::doNotOptimize(result.getError());
+    });
+
+    suite.add("Expected<int> with context, message()", [&failing] {
+        auto result = expectedParseWithContext(failing);
+        if (result.getError() != ErrorCode::NO_ERROR)
+            bench::doNotOptimize(result.message().size());
+    });
+
+    suite.add("Expected<int> move", [&input] {
+        auto result = expectedParse(input);
+        auto moved = std::move(result);
+        if (moved.getError() == ErrorCode::NO_ERROR)
+            bench::doNotOptimize(moved.get());
+    });
+
+    suite.add("Expected<void> construct+check", [&input] {
+        bench::doNotOptimize(expectedCheck(input).getError());
+    });
+
+    suite.add("Expected<std::string> construct+check", [&input] {
+        auto result = expectedString(input);
+        if (result.getError() == ErrorCode::NO_ERROR)
+            bench::doNotOptimize(result.get().size());
+    });
+
+    suite.add("Expected<std::string> move", [&input] {
+        auto result = expectedString(input);
+        auto moved = std::move(result);
+        if (moved.getError() == ErrorCode::NO_ERROR)
+            bench::doNotOptimize(moved.get().size());
+    });
+
+    return suite.run();
+}
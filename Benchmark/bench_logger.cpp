@@ -0,0 +1,40 @@
+#include "Benchmark.hpp"
+#include "../Logger/BinaryLogger.h"
+#include "../Logger/Logger.h"
+
+// per-call cost of the logging front ends, lines go to a discarding sink so
+// only formatting and hand-off are measured
+namespace {
+    struct NullSink : log::Sink {
+        void write(char const*, std::size_t) override {}
+    };
+}
+
+int main(int argc, char const* argv[]) {
+    auto suite = bench::Suite{"logger", argc, argv};
+    auto sink = NullSink{};
+    log::setSink(&sink);
+    auto value = 42;
+
+    suite.add("log::info", [&value] { log::info("request", value, "took", 1.5, "ms"); });
+    suite.add("log::error", [&value] { log::error("request", value, "failed"); });
+    suite.add("LOG_INFO", [&value] { LOG_INFO("request", value, "took", 1.5, "ms"); });
+    suite.add("LOG_INFO_EVERY_N(100)", [&value] { LOG_INFO_EVERY_N(100, "request", value, "took", 1.5, "ms"); });
+
+    suite.add("LOG_INFO filtered out",
+            [] { log::setLevel(log::Level::WARN); },
+            [&value] { LOG_INFO("request", value, "took", 1.5, "ms"); },
+            [] { log::setLevel(log::Level::INFO); });
+
+    suite.add("LOG_INFO async",
+            [] { log::async::start({}); },
+            [&value] { LOG_INFO("request", value, "took", 1.5, "ms"); },
+            [] { log::async::stop(); });
+
+    suite.add("LOG_BIN_INFO",
+            [] { log::binary::open("/dev/null"); },
+            [&value] { LOG_BIN_INFO("request {} took {} ms", value, 1.5); },
+            [] { log::binary::close(); });
+
+    return suite.run();
+}
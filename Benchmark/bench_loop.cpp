@@ -0,0 +1,71 @@
+#include <iostream>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include "Benchmark.hpp"
+#include "../Process/Loop.hpp"
+
+// C++20. Throughput of N concurrent children started and waited for from one
+// thread: execute() and a blocking wait() on each future, against coroutines
+// on a process::Loop awaiting the same Reaper-watched children, and awaiting
+// unwatched ones (no Reaper thread hop, no future). One op is the whole batch.
+namespace {
+    struct NullBuffer : std::streambuf {
+        int overflow(int c) override { return c; }
+        std::streamsize xsputn(char const*, std::streamsize n) override { return n; }
+    };
+
+    process::Task await(process::Child child) {
+        auto status = co_await child.exited();
+        bench::doNotOptimize(status.exitStatus);
+    }
+}
+
+int main(int argc, char const* argv[]) {
+    // one pidfd per child
+    auto limit = rlimit{};
+    if (::getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+        limit.rlim_cur = limit.rlim_max;
+        ::setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    auto suite = bench::Suite{"loop", argc, argv};
+    auto null = NullBuffer{};
+    auto report = std::ostream{std::cout.rdbuf(&null)};
+    suite.setOutput(report);
+
+    auto command = process::CommandLine{"/bin/true"};
+    for (auto n : {100, 1000}) {
+        auto batch = std::to_string(n) + " children";
+        suite.add("futures: " + batch + ", wait() each", 1, [&command, n] {
+            auto children = std::vector<process::Child>{};
+            children.reserve(n);
+            for (auto i = 0; i < n; i++)
+                children.push_back(process::execute(command, "", true));
+            for (auto& child : children)
+                bench::doNotOptimize(child.wait().exitStatus);
+        });
+
+        suite.add("Loop: " + batch + ", co_await Reaper's", 1, [&command, n] {
+            auto loop = process::Loop{};
+            for (auto i = 0; i < n; i++)
+                loop.spawn(await(process::execute(command, "", true)));
+            loop.run();
+        });
+
+        suite.add("Loop: " + batch + ", co_await unwatched", 1, [&command, n] {
+            auto loop = process::Loop{};
+            for (auto i = 0; i < n; i++)
+                loop.spawn(await(process::executeUnwatched(command, "", true)));
+            loop.run();
+        });
+    }
+
+    auto code = suite.run();
+    std::cout.rdbuf(report.rdbuf());
+    return code;
+}
@@ -0,0 +1,68 @@
+#include <chrono>
+#include <iostream>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "Benchmark.hpp"
+#include "../Process/Pool.hpp"
+
+// running a short-lived perl helper: spawned per job, or handed out by a
+// process::Pool. The latency the caller sees is the acquisition, the pool's
+// p99 is printed after the table; on a single core the background refill
+// competes with the loop, so end-to-end throughput gains less.
+namespace {
+    struct NullBuffer : std::streambuf {
+        int overflow(int c) override { return c; }
+        std::streamsize xsputn(char const*, std::streamsize n) override { return n; }
+    };
+
+    auto const HELPER = "/usr/bin/perl -MPOSIX -MData::Dumper -e 'print uc while <STDIN>'";
+}
+
+int main(int argc, char const* argv[]) {
+    auto suite = bench::Suite{"pool", argc, argv};
+    auto null = NullBuffer{};
+    auto report = std::ostream{std::cout.rdbuf(&null)};
+    suite.setOutput(report);
+
+    auto helper = process::CommandLine{HELPER};
+    suite.add("execute helper, send input, wait", [&helper] {
+        auto capture = process::Capture{};
+        capture.onOutput = [](process::Capture::Stream, char const* data, std::size_t) { bench::doNotOptimize(data); };
+        int input[2];
+        if (::pipe2(input, O_CLOEXEC) == -1 || ::write(input[1], "some input\n", 11) != 11)
+            return;
+        ::close(input[1]);
+        auto child = process::execute(helper, "", input[0], capture);
+        ::close(input[0]);
+        bench::doNotOptimize(child.wait().exitStatus);
+    });
+
+    auto options = process::Pool::Options{};
+    options.minIdle = 4;
+    auto pool = std::unique_ptr<process::Pool>{};
+    suite.add("Pool acquire helper, wait", [&] {
+        pool.reset(new process::Pool{helper, options});
+        while (pool->metrics().idle < options.minIdle)
+            std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }, [&pool] {
+        auto child = pool->acquire("some input\n", [](process::Capture::Stream, char const* data, std::size_t) {
+            bench::doNotOptimize(data);
+        });
+        bench::doNotOptimize(child.wait().exitStatus);
+    }, [] {});
+
+    auto code = suite.run();
+    auto metrics = pool->metrics();
+    report << "\npool: " << metrics.hits << " hits, " << metrics.misses << " misses, hit rate "
+        << metrics.hitRate() * 100 << "%, acquisition p50 " << metrics.p50 / 1000.0 << " us, p99 "
+        << metrics.p99 / 1000.0 << " us, " << metrics.target << " idle targeted\n";
+    pool.reset();
+    std::cout.rdbuf(report.rdbuf());
+    return code;
+}
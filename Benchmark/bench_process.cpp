@@ -0,0 +1,80 @@
+#include <iostream>
+#include <ostream>
+#include <streambuf>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "Benchmark.hpp"
+#include "../Process/Process.hpp"
+
+// spawn-to-reap latency of process::execute, the default 50 ms calibration
+// gives a few dozen children per repetition
+namespace {
+    struct NullBuffer : std::streambuf {
+        int overflow(int c) override { return c; }
+        std::streamsize xsputn(char const*, std::streamsize n) override { return n; }
+    };
+}
+
+int main(int argc, char const* argv[]) {
+    auto suite = bench::Suite{"process", argc, argv};
+    auto null = NullBuffer{};
+    auto report = std::ostream{std::cout.rdbuf(&null)};
+    suite.setOutput(report);
+
+    suite.add("execute+wait /bin/true", [] {
+        auto child = process::execute("/bin/true", "", true);
+        bench::doNotOptimize(child.wait().exitStatus);
+    });
+
+    suite.add("execute+wait /bin/true with arguments", [] {
+        auto child = process::execute("/bin/true --first 'a quoted argument' --last", "", true);
+        bench::doNotOptimize(child.wait().exitStatus);
+    });
+
+    auto prepared = process::CommandLine{"/bin/true --first 'a quoted argument' --last"};
+    suite.add("execute+wait prepared CommandLine", [&prepared] {
+        auto child = process::execute(prepared, "", true);
+        bench::doNotOptimize(child.wait().exitStatus);
+    });
+
+    suite.add("CommandLine split", [] {
+        auto commandLine = process::CommandLine{"/bin/true --first 'a quoted argument' --name=\"x y\" --last"};
+        bench::doNotOptimize(commandLine.argv());
+    });
+
+    // collecting 1 MB of output: what a shell pipeline costs against the pump
+    auto generate = process::CommandLine{"/usr/bin/head -c 1000000 /dev/zero"};
+    suite.add("1 MB through sh -c '... | cat'", [] {
+        auto child = process::execute("/bin/sh -c '/usr/bin/head -c 1000000 /dev/zero | /bin/cat >/dev/null'", "", false);
+        bench::doNotOptimize(child.wait().exitStatus);
+    });
+
+    suite.add("1 MB captured in chunks", [&generate] {
+        auto bytes = std::size_t{0};
+        auto capture = process::Capture{};
+        capture.onOutput = [&bytes](process::Capture::Stream, char const*, std::size_t size) { bytes += size; };
+        auto child = process::execute(generate, "", capture);
+        bench::doNotOptimize(child.wait().exitStatus);
+        bench::doNotOptimize(bytes);
+    });
+
+    auto devnull = ::open("/dev/null", O_WRONLY | O_CLOEXEC);
+    suite.add("1 MB spliced into a file", [&generate, devnull] {
+        auto capture = process::Capture{};
+        capture.file = devnull;
+        auto child = process::execute(generate, "", capture);
+        bench::doNotOptimize(child.wait().exitStatus);
+    });
+
+    suite.add("execute+wait missing binary", [] {
+        auto child = process::execute("/nonexistent/binary", "", true);
+        bench::doNotOptimize(child.wait().exitStatus);
+    });
+
+    auto code = suite.run();
+    std::cout.rdbuf(report.rdbuf());
+    ::close(devnull);
+    return code;
+}
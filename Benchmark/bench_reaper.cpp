@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../Process/Reaper.hpp"
+
+// memory and reap latency of watching N children: one thread per child
+// blocking in waitpid() (what process::Child did) against the Reaper.
+// The children block on a pipe and all exit when it is closed, the latency
+// is from closing it to each child's future becoming ready.
+namespace {
+    struct Memory {
+        long rssKb = 0;
+        long virtualKb = 0;
+        long threads = 0;
+    };
+
+    Memory memory() {
+        auto memory = Memory{};
+        auto in = std::ifstream{"/proc/self/status"};
+        auto line = std::string{};
+        while (std::getline(in, line)) {
+            if (line.compare(0, 6, "VmRSS:") == 0)
+                memory.rssKb = std::stol(line.substr(6));
+            else if (line.compare(0, 7, "VmSize:") == 0)
+                memory.virtualKb = std::stol(line.substr(7));
+            else if (line.compare(0, 8, "Threads:") == 0)
+                memory.threads = std::stol(line.substr(8));
+        }
+        return memory;
+    }
+
+    using Done = std::shared_ptr<std::promise<std::chrono::steady_clock::time_point>>;
+
+    // false when the child had to be handed to the reaper instead
+    using Watch = bool (*)(pid_t, Done);
+
+    bool reaper(pid_t pid, Done done) {
+        process::Reaper::instance().watch(pid, [done](process::Status) {
+            done->set_value(std::chrono::steady_clock::now());
+        });
+        return true;
+    }
+
+    bool threadPerChild(pid_t pid, Done done) {
+        try {
+            std::thread{[pid, done] {
+                int wstatus = 0;
+                while (::waitpid(pid, &wstatus, 0) != pid && errno == EINTR) {
+                    errno = 0;
+                }
+                done->set_value(std::chrono::steady_clock::now());
+            }}.detach();
+            return true;
+        } catch (std::system_error const&) {
+            // thread creation fails long before fork does, the child still has to be reaped
+            reaper(pid, std::move(done));
+            return false;
+        }
+    }
+
+    void run(char const* name, Watch watch, int children) {
+        int release[2];
+        if (::pipe(release) == -1) {
+            std::perror("pipe");
+            return;
+        }
+
+        auto before = memory();
+        auto futures = std::vector<std::future<std::chrono::steady_clock::time_point>>{};
+        futures.reserve(children);
+        auto handedOver = 0;
+        for (auto spawned = 0; spawned < children; spawned++) {
+            auto pid = ::fork();
+            if (pid == -1) {
+                std::perror("fork");
+                break;
+            }
+            if (pid == 0) {
+                char c;
+                ::close(release[1]);
+                while (::read(release[0], &c, 1) == -1 && errno == EINTR) {}
+                ::_exit(0);
+            }
+
+            auto done = std::make_shared<std::promise<std::chrono::steady_clock::time_point>>();
+            futures.push_back(done->get_future());
+            if (!watch(pid, std::move(done)))
+                handedOver++;
+        }
+        if (handedOver != 0)
+            std::printf("%s: couldn't create a thread for %d children, the reaper waited for them\n",
+                    name, handedOver);
+        auto watching = memory();
+
+        auto start = std::chrono::steady_clock::now();
+        ::close(release[1]);
+        ::close(release[0]);
+
+        auto latencies = std::vector<double>{};
+        for (auto& future : futures)
+            latencies.push_back(std::chrono::duration<double, std::milli>(future.get() - start).count());
+        std::sort(latencies.begin(), latencies.end());
+
+        // legacy threads are detached, give them time to exit before the next run
+        while (memory().threads > before.threads)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+        auto percentile = [&latencies](double p) {
+            return latencies.empty() ? 0.0 : latencies[static_cast<std::size_t>(p * (latencies.size() - 1))];
+        };
+        std::printf("%-16s %8d %10ld %12ld %10ld %10.2f %10.2f %10.2f\n", name, static_cast<int>(futures.size()),
+                watching.threads - before.threads, watching.rssKb - before.rssKb,
+                (watching.virtualKb - before.virtualKb) / 1024, percentile(0.5), percentile(0.99),
+                percentile(1.0));
+    }
+}
+
+int main(int argc, char const* argv[]) {
+    // one pidfd per child
+    auto limit = rlimit{};
+    if (::getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+        limit.rlim_cur = limit.rlim_max;
+        ::setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    // its thread is not part of what a run adds
+    process::Reaper::instance();
+
+    auto counts = std::vector<int>{10, 1000, 10000};
+    if (argc > 1) {
+        counts.clear();
+        for (int i = 1; i < argc; i++)
+            counts.push_back(std::atoi(argv[i]));
+    }
+
+    std::printf("%-16s %8s %10s %12s %10s %10s %10s %10s\n", "watcher", "children", "+threads", "+RSS KiB",
+            "+VM MiB", "p50 ms", "p99 ms", "max ms");
+    for (auto children : counts) {
+        run("thread per child", threadPerChild, children);
+        run("reaper", reaper, children);
+    }
+}
@@ -0,0 +1,33 @@
+#include "Benchmark.hpp"
+#include "../ScopeGuard/ScopeGuard.hpp"
+
+int main(int argc, char const* argv[]) {
+    auto suite = bench::Suite{"scopeguard", argc, argv};
+    auto counter = 0;
+
+    suite.add("manual cleanup", [&counter] {
+        counter++;
+        bench::doNotOptimize(counter);
+        counter--;
+    });
+
+    suite.add("MakeScopeGuard", [&counter] {
+        counter++;
+        auto guard = MakeScopeGuard([&counter] { counter--; });
+        bench::doNotOptimize(counter);
+    });
+
+    suite.add("new/delete manual", [] {
+        auto buff = new char[1024];
+        bench::doNotOptimize(buff);
+        delete[] buff;
+    });
+
+    suite.add("new/delete MakeScopeGuard", [] {
+        auto buff = new char[1024];
+        auto buff_guard = MakeScopeGuard([buff] { delete[] buff; });
+        bench::doNotOptimize(buff);
+    });
+
+    return suite.run();
+}
@@ -0,0 +1,44 @@
+#include <ostream>
+#include <streambuf>
+
+#include "Benchmark.hpp"
+#include "../ScopedTimer/PerfCounters.hpp"
+#include "../ScopedTimer/ScopedTimer.hpp"
+#include "../ScopedTimer/TimerRegistry.hpp"
+#include "../ScopedTimer/Trace.hpp"
+
+// overhead of timing an empty scope; the printing timers write to a
+// discarding buffer so the terminal is not measured
+namespace {
+    struct NullBuffer : std::streambuf {
+        int overflow(int c) override { return c; }
+        std::streamsize xsputn(char const*, std::streamsize n) override { return n; }
+    };
+}
+
+int main(int argc, char const* argv[]) {
+    auto suite = bench::Suite{"scopedtimer", argc, argv};
+    auto null = NullBuffer{};
+    auto report = std::ostream{std::cout.rdbuf(&null)};
+    suite.setOutput(report);
+
+    suite.add("steady_clock::now() pair", [] {
+        auto start = std::chrono::steady_clock::now();
+        bench::doNotOptimize(std::chrono::steady_clock::now() - start);
+    });
+
+    suite.add("ScopedTimer", [] { auto timer = ScopedTimer{"scope"}; });
+    suite.add("TscScopedTimer", [] { auto timer = TscScopedTimer{"scope"}; });
+    suite.add("PerfScopedTimer", [] { auto timer = PerfScopedTimer{"scope"}; });
+    suite.add("AGGREGATE_SCOPED_TIMER", [] { AGGREGATE_SCOPED_TIMER("scope"); });
+
+    suite.add("TRACE_SCOPE disabled", [] { TRACE_SCOPE("scope"); });
+    suite.add("TRACE_SCOPE enabled",
+            [] { Trace::enable(); },
+            [] { TRACE_SCOPE("scope"); },
+            [] { Trace::disable(); });
+
+    auto code = suite.run();
+    std::cout.rdbuf(report.rdbuf());
+    return code;
+}
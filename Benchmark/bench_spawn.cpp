@@ -0,0 +1,52 @@
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string>
+
+#include "Benchmark.hpp"
+#include "../Process/Process.hpp"
+
+// spawn-to-reap latency of process::execute against the parent's RSS, for
+// both backends: fork() copies the page tables of the touched ballast, so its
+// cost grows with the RSS, posix_spawn() shares the address space until exec
+namespace {
+    struct NullBuffer : std::streambuf {
+        int overflow(int c) override { return c; }
+        std::streamsize xsputn(char const*, std::streamsize n) override { return n; }
+    };
+
+    std::unique_ptr<char[]> ballast;
+
+    // resident, not just reserved: every page is written
+    void grow(std::size_t megabytes) {
+        auto size = megabytes << 20;
+        ballast.reset(new char[size]);
+        for (std::size_t i = 0; i < size; i += 4096)
+            ballast[i] = 1;
+        bench::doNotOptimize(ballast[0]);
+    }
+}
+
+int main(int argc, char const* argv[]) {
+    auto suite = bench::Suite{"spawn", argc, argv};
+    auto null = NullBuffer{};
+    auto report = std::ostream{std::cout.rdbuf(&null)};
+    suite.setOutput(report);
+
+    for (auto megabytes : {0, 256, 1024, 2048}) {
+        for (auto backend : {process::Backend::Fork, process::Backend::Spawn}) {
+            auto name = std::string{backend == process::Backend::Fork ? "fork" : "spawn"}
+                + " /bin/true, rss +" + std::to_string(megabytes) + " MB";
+            suite.add(name, [megabytes] { grow(megabytes); }, [backend] {
+                auto child = process::execute("/bin/true", "", true, true, backend);
+                bench::doNotOptimize(child.wait().exitStatus);
+            }, [] { ballast.reset(); });
+        }
+    }
+
+    auto code = suite.run();
+    std::cout.rdbuf(report.rdbuf());
+    return code;
+}
@@ -0,0 +1,224 @@
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "Benchmark.hpp"
+#include "../StateMachine/MachineBatch.hpp"
+#include "../StateMachine/StateMachine1.hpp"
+#include "../StateMachine/TransitionTrace.hpp"
+
+// next() traces every transition to std::cout, which is part of its cost;
+// the trace goes to bench::SilenceStdout so the terminal is not measured.
+// Stepping with next()'s linear search and trace against a StateTable, for
+// g_transitions (5 transitions) and synthetic tables of 100 and 1000. A tick
+// of 1M machines, one Machine at a time against a MachineBatch.
+namespace {
+    enum class SyntheticState : std::uint16_t {};
+    enum class SyntheticTransition : std::uint8_t {};
+
+    inline std::ostream& operator<<(std::ostream& out, SyntheticState state) {
+        return out << static_cast<unsigned>(state);
+    }
+
+    inline std::ostream& operator<<(std::ostream& out, SyntheticTransition transition) {
+        return out << static_cast<unsigned>(transition);
+    }
+
+    struct SyntheticEntry {
+        SyntheticState source;
+        SyntheticTransition transition;
+        SyntheticState destination;
+    };
+
+    // two transitions per state: around a ring, or a jump across it
+    template <std::size_t States> constexpr std::array<SyntheticEntry, States * 2> syntheticTable() {
+        auto table = std::array<SyntheticEntry, States * 2>{};
+        for (std::size_t state = 0; state < States; state++) {
+            table[state * 2] = {SyntheticState(state), SyntheticTransition(0), SyntheticState((state + 1) % States)};
+            table[state * 2 + 1] = {SyntheticState(state), SyntheticTransition(1), SyntheticState((state * 7 + 3) % States)};
+        }
+        return table;
+    }
+
+    constexpr auto TABLE_100 = syntheticTable<50>();
+    constexpr auto TABLE_1000 = syntheticTable<500>();
+
+    using Table100 = StateTable<TABLE_100, 50, 2, SyntheticState(0), SyntheticState(0)>;
+    using Table1000 = StateTable<TABLE_1000, 500, 2, SyntheticState(0), SyntheticState(0)>;
+
+    // what next() does, for any table
+    template <typename Table, typename S, typename T> S linearNext(Table const& table, S state, T transition) {
+        for (auto& entry : table) {
+            if (entry.source == state && entry.transition == transition) {
+                std::cout << "transition " << entry.source << " -> " << entry.transition \
+                << " -> " << entry.destination << std::endl;
+                return entry.destination;
+            }
+        }
+        assert(false);
+        return state;
+    }
+
+    // the same pseudo-random walk for every case
+    struct Walk {
+        std::array<std::uint8_t, 1024> transitions;
+        std::size_t at = 0;
+
+        Walk() {
+            auto x = std::uint32_t{12345};
+            for (auto& transition : this->transitions) {
+                x = x * 1664525 + 1013904223;
+                transition = static_cast<std::uint8_t>(x >> 31);
+            }
+        }
+
+        std::uint8_t next() { return this->transitions[this->at++ & 1023]; }
+    };
+
+    // the demo machine of StateMachine1.cpp, without its I/O-bound failure action
+    void runMachine(int loops) {
+        auto machine = Machine{};
+        machine.loop = loops;
+        while (true) {
+            machine.state = next(machine.state, machine.transition);
+            switch (machine.state) {
+            case State::S_END_MACHINE:
+                return;
+            case State::S_SAMPLE_0:
+                machine.transition = executeActionSample0(machine);
+                break;
+            case State::S_SAMPLE_1:
+                machine.transition = executeActionSample1(machine);
+                break;
+            default:
+                machine.transition = Transition::T_DEFAULT;
+                break;
+            }
+        }
+    }
+
+    // a tick of main()'s loop for one Machine, StateTable lookups
+    void stepMachine(Machine& machine) {
+        if (machine.state == State::S_END_MACHINE)
+            return;
+        machine.state = Transitions1::next(machine.state, machine.transition);
+        switch (machine.state) {
+        case State::S_SAMPLE_0:
+            machine.transition = executeActionSample0(machine);
+            break;
+        case State::S_SAMPLE_1:
+            machine.transition = executeActionSample1(machine);
+            break;
+        case State::S_FAILURE:
+            machine.transition = executeActionFailure(machine);
+            break;
+        default:
+            break;
+        }
+    }
+
+    constexpr auto POPULATION = std::size_t{1} << 20;
+
+    // enough loops that no machine ends while measured
+    constexpr auto POPULATION_LOOPS = 100000;
+
+    // machines started on different ticks, as connections are: a random half
+    // is one step ahead, so neighbours are in different states
+    bool ahead(std::size_t i) {
+        return ((i * 2654435761u) >> 16 & 1) != 0;
+    }
+}
+
+int main(int argc, char const* argv[]) {
+    auto silenced = bench::SilenceStdout{};
+    auto suite = bench::Suite{"statemachine", argc, argv};
+    suite.setOutput(silenced.out());
+
+    suite.add("next() first entry", [] {
+        bench::doNotOptimize(next(State::S_START_MACHINE, Transition::T_DEFAULT));
+    });
+
+    auto state = State::S_SAMPLE_0;
+
+    suite.add("next() ping-pong", [&state] {
+        state = next(state, Transition::T_DEFAULT);
+        bench::doNotOptimize(state);
+    });
+
+    suite.add("next() last entry", [] {
+        bench::doNotOptimize(next(State::S_FAILURE, Transition::T_DEFAULT));
+    });
+
+    suite.add("machine 100 loops", [] { runMachine(100); });
+
+    // g_transitions: the walk only takes T_DEFAULT around S_SAMPLE_0 <-> S_SAMPLE_1
+    auto walked = State::S_SAMPLE_0;
+    suite.add("step 5 transitions: next()", [&walked] {
+        walked = next(walked, Transition::T_DEFAULT);
+        bench::doNotOptimize(walked);
+    });
+    suite.add("step 5 transitions: StateTable", [&walked] {
+        walked = Transitions1::next(walked, Transition::T_DEFAULT);
+        bench::doNotOptimize(walked);
+    });
+
+    // the ring is attached by the first record, before the timed ones
+    suite.add("step 5 transitions: StateTable + TransitionTrace", [&walked] {
+        auto source = walked;
+        walked = Transitions1::next(source, Transition::T_DEFAULT);
+        transitionTrace::record(0, source, Transition::T_DEFAULT, walked);
+        bench::doNotOptimize(walked);
+    });
+
+    auto walk = Walk{};
+    auto synthetic = SyntheticState(0);
+    suite.add("step 100 transitions: next()", [&] {
+        synthetic = linearNext(TABLE_100, synthetic, SyntheticTransition(walk.next()));
+        bench::doNotOptimize(synthetic);
+    });
+    suite.add("step 100 transitions: StateTable", [&] {
+        synthetic = Table100::next(synthetic, SyntheticTransition(walk.next()));
+        bench::doNotOptimize(synthetic);
+    });
+
+    synthetic = SyntheticState(0);
+    suite.add("step 1000 transitions: next()", [&] {
+        synthetic = linearNext(TABLE_1000, synthetic, SyntheticTransition(walk.next()));
+        bench::doNotOptimize(synthetic);
+    });
+    suite.add("step 1000 transitions: StateTable", [&] {
+        synthetic = Table1000::next(synthetic, SyntheticTransition(walk.next()));
+        bench::doNotOptimize(synthetic);
+    });
+
+    auto machines = std::vector<Machine>{};
+    suite.add("tick 1M machines: Machine", [&machines] {
+        machines.assign(POPULATION, Machine{State::S_START_MACHINE, Transition::T_DEFAULT, POPULATION_LOOPS});
+        for (std::size_t i = 0; i < POPULATION; i++) {
+            stepMachine(machines[i]);
+            if (ahead(i))
+                stepMachine(machines[i]);
+        }
+    }, [&machines] {
+        for (auto& machine : machines)
+            stepMachine(machine);
+        bench::clobberMemory();
+    }, [&machines] { machines = {}; });
+
+    auto batch = MachineBatch{};
+    suite.add("tick 1M machines: MachineBatch", [&batch] {
+        for (std::size_t i = 0; i < POPULATION; i++) {
+            auto machine = Machine{State::S_START_MACHINE, Transition::T_DEFAULT, POPULATION_LOOPS};
+            stepMachine(machine);
+            if (ahead(i))
+                stepMachine(machine);
+            batch.add(machine);
+        }
+    }, [&batch] {
+        batch.step();
+        bench::clobberMemory();
+    }, [&batch] { batch = MachineBatch{}; });
+
+    return suite.run();
+}
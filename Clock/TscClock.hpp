@@ -0,0 +1,127 @@
+#ifndef __TSC_CLOCK_HPP__
+#define __TSC_CLOCK_HPP__
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define TSC_CLOCK_X86 1
+#endif
+
+// std::chrono-style clock reading the time-stamp counter when the CPU reports
+// an invariant TSC (constant rate, keeps counting in deep C-states), and
+// steady_clock otherwise. ticks() is the raw counter: keep it in hot paths and
+// convert differences with toDuration() at report time.
+class TscClock {
+    public:
+        using rep = std::int64_t;
+        using period = std::nano;
+        using duration = std::chrono::nanoseconds;
+        using time_point = std::chrono::time_point<TscClock>;
+        static constexpr bool is_steady = true;
+
+        static bool isInvariant() noexcept { return s_invariant; }
+
+        static std::uint64_t ticks() noexcept {
+#ifdef TSC_CLOCK_X86
+            if (s_invariant)
+                return __rdtsc();
+#endif
+            return steadyTicks();
+        }
+
+        // waits for the preceding instructions to retire, for the end of a measurement
+        static std::uint64_t ticksOrdered() noexcept {
+#ifdef TSC_CLOCK_X86
+            if (s_invariant) {
+                unsigned int aux;
+                return __rdtscp(&aux);
+            }
+#endif
+            return steadyTicks();
+        }
+
+        static duration toDuration(std::int64_t ticks) noexcept {
+            auto product = static_cast<__int128>(ticks) * calibration().multiplier;
+            return duration{static_cast<rep>(product >> SHIFT)};
+        }
+
+        // converts on every call (and calibrates on the first), prefer ticks() in hot paths
+        static time_point now() noexcept {
+            return time_point{toDuration(static_cast<std::int64_t>(ticks()))};
+        }
+
+        static double ticksPerSecond() { return calibration().ticksPerSecond; }
+
+        // the first conversion measures the TSC rate (~20ms), call this at startup to pay it early
+        static void calibrate() { (void)calibration(); }
+
+    private:
+        static constexpr int SHIFT = 32;
+
+        struct Calibration {
+            std::int64_t multiplier; // nanoseconds per tick << SHIFT
+            double ticksPerSecond;
+        };
+
+        static std::uint64_t steadyTicks() noexcept {
+            return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+
+        static bool detectInvariant() noexcept {
+#ifdef TSC_CLOCK_X86
+            unsigned int eax, ebx, ecx, edx;
+            if (__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) == 0 || eax < 0x80000007)
+                return false;
+            if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) == 0)
+                return false;
+            return (edx & (1u << 8)) != 0;
+#else
+            return false;
+#endif
+        }
+
+        // TSC read bracketed by two steady_clock reads, the tightest bracket of a few tries wins
+        static void sample(std::int64_t& ns, std::uint64_t& tsc) {
+            auto best = std::int64_t{-1};
+            for (int i = 0; i < 16; i++) {
+                auto before = static_cast<std::int64_t>(steadyTicks());
+                auto t = ticksOrdered();
+                auto after = static_cast<std::int64_t>(steadyTicks());
+                if (best < 0 || after - before < best) {
+                    best = after - before;
+                    ns = before + (after - before) / 2;
+                    tsc = t;
+                }
+            }
+        }
+
+        static Calibration measure() {
+            if (!s_invariant)
+                return {std::int64_t{1} << SHIFT, 1e9};
+
+            auto ns0 = std::int64_t{}, ns1 = std::int64_t{};
+            auto tsc0 = std::uint64_t{}, tsc1 = std::uint64_t{};
+            sample(ns0, tsc0);
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            sample(ns1, tsc1);
+
+            auto elapsedNs = static_cast<double>(ns1 - ns0);
+            auto elapsedTicks = static_cast<double>(tsc1 - tsc0);
+            return {static_cast<std::int64_t>(elapsedNs / elapsedTicks * static_cast<double>(std::int64_t{1} << SHIFT)),
+                elapsedTicks * 1e9 / elapsedNs};
+        }
+
+        static Calibration const& calibration() {
+            static Calibration const c = measure();
+            return c;
+        }
+
+        static inline bool const s_invariant = detectInvariant();
+};
+
+#endif //__TSC_CLOCK_HPP__
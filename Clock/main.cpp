@@ -0,0 +1,43 @@
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+
+#include "TscClock.hpp"
+
+// per-read cost of each clock source
+template <typename F> void measure(char const* name, F&& read) {
+    constexpr int READS = 10000000;
+    auto sink = std::uint64_t{0};
+    for (int i = 0; i < 100000; i++)
+        sink += read();
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < READS; i++)
+        sink += read();
+    auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start);
+
+    std::cout << std::setw(28) << std::left << name << std::right << std::setw(8) << std::fixed
+        << std::setprecision(2) << elapsed.count() / READS << " ns" << (sink == 0 ? " " : "") << "\n";
+}
+
+template <typename Clock> std::uint64_t chronoRead() {
+    return static_cast<std::uint64_t>(Clock::now().time_since_epoch().count());
+}
+
+int main() {
+    TscClock::calibrate();
+    std::cout << "invariant TSC: " << (TscClock::isInvariant() ? "yes" : "no, using steady_clock")
+        << ", " << std::fixed << std::setprecision(3) << TscClock::ticksPerSecond() / 1e9 << " GHz\n";
+
+    measure("steady_clock::now", chronoRead<std::chrono::steady_clock>);
+    measure("high_resolution_clock::now", chronoRead<std::chrono::high_resolution_clock>);
+    measure("system_clock::now", chronoRead<std::chrono::system_clock>);
+    measure("CLOCK_MONOTONIC_COARSE", [] {
+        auto ts = timespec{};
+        ::clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+        return static_cast<std::uint64_t>(ts.tv_nsec);
+    });
+    measure("TscClock::ticks", TscClock::ticks);
+    measure("TscClock::ticksOrdered", TscClock::ticksOrdered);
+    measure("TscClock::now", chronoRead<TscClock>);
+}
@@ -0,0 +1,40 @@
+#ifndef __ERROR_CODE_HPP__
+#define __ERROR_CODE_HPP__
+
+// The registry of error codes: name, value and category, in one place so the
+// enum and its strings can't drift apart. Add new error codes here.
+#define ERROR_CODES(X)                          \
+  X(NO_ERROR, 0, "none")                        \
+  X(EC_INVALID_INPUT, 0x10, "input")
+
+enum class ErrorCode {
+#define ERROR_CODE_ENUM(name, value, category) name = value,
+  ERROR_CODES(ERROR_CODE_ENUM)
+#undef ERROR_CODE_ENUM
+};
+
+// constexpr switches: folded when the code is a constant, a jump table
+// otherwise. Two codes with the same value don't compile.
+constexpr char const* toString(ErrorCode code) {
+  switch (code) {
+#define ERROR_CODE_NAME(name, value, category) \
+  case ErrorCode::name:                        \
+    return #name;
+    ERROR_CODES(ERROR_CODE_NAME)
+#undef ERROR_CODE_NAME
+  }
+  return "unknown error code";
+}
+
+constexpr char const* category(ErrorCode code) {
+  switch (code) {
+#define ERROR_CODE_CATEGORY(name, value, category) \
+  case ErrorCode::name:                            \
+    return category;
+    ERROR_CODES(ERROR_CODE_CATEGORY)
+#undef ERROR_CODE_CATEGORY
+  }
+  return "unknown";
+}
+
+#endif //__ERROR_CODE_HPP__
@@ -0,0 +1,189 @@
+#ifndef __ERROR_CONTEXT_HPP__
+#define __ERROR_CONTEXT_HPP__
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// Where an error was made and with what: call site, errno and up to MAX_ARGS
+// arguments, stored as raw values in a thread-local ring of SLOTS entries.
+// Capturing is a handful of stores, nothing is formatted until describe() is
+// called, usually by whoever finally reports the error. A Handle outlives its
+// entry once SLOTS newer errors were captured on the thread, describe() then
+// says so. Handles are described on the thread that captured them: sequences
+// are unique across threads (each takes them from a shared counter, SLOTS at
+// a time), so another thread's Handle isn't taken for one of its own entries.
+namespace ErrorContext {
+  static constexpr std::size_t SLOTS = 64;
+  static constexpr std::size_t MAX_ARGS = 6;
+  static constexpr std::size_t TEXT_SIZE = 96; // string arguments, truncated past it
+
+  // 0: no context
+  struct Handle {
+    std::uint32_t sequence = 0;
+
+    explicit operator bool() const { return this->sequence != 0; }
+  };
+
+  struct Site {
+    char const* file;
+    int line;
+    char const* function;
+  };
+
+  namespace detail {
+    struct Arg {
+      enum Kind : std::uint8_t { Signed, Unsigned, Double, Bool, Text, Pointer } kind;
+      std::uint8_t offset; // Text: where in the entry's text
+      std::uint8_t size;
+      union {
+        std::int64_t i;
+        std::uint64_t u;
+        double d;
+        void const* p;
+      };
+    };
+
+    struct Entry {
+      std::uint32_t sequence;
+      int savedErrno;
+      Site site;
+      std::uint8_t count;
+      std::uint8_t textUsed;
+      Arg args[MAX_ARGS];
+      char text[TEXT_SIZE];
+    };
+
+    struct Ring {
+      std::uint32_t next; // sequence of the next capture
+      std::uint32_t left; // sequences left from the thread's block
+      Entry entries[SLOTS];
+    };
+
+    // zero-initialized, no guard on access
+    inline thread_local Ring ring;
+
+    // the first sequence of the next block a thread takes
+    inline std::atomic<std::uint32_t> nextBlock{0};
+
+    inline void capture(Entry& entry, Arg& arg, std::string_view text) {
+      auto size = std::min(text.size(), TEXT_SIZE - entry.textUsed);
+      // words, then bytes: short strings don't pay for rep movs
+      auto to = entry.text + entry.textUsed;
+      auto i = std::size_t{0};
+      for (; i + 8 <= size; i += 8)
+        std::memcpy(to + i, text.data() + i, 8);
+      for (; i < size; i++)
+        to[i] = text[i];
+      arg.kind = Arg::Text;
+      arg.offset = entry.textUsed;
+      arg.size = static_cast<std::uint8_t>(size);
+      entry.textUsed = static_cast<std::uint8_t>(entry.textUsed + size);
+    }
+
+    template <typename T> void capture(Entry& entry, Arg& arg, T const& value) {
+      using V = std::decay_t<T>;
+      if constexpr (std::is_same<V, bool>::value) {
+        arg.kind = Arg::Bool;
+        arg.u = value;
+      } else if constexpr (std::is_enum<V>::value) {
+        arg.kind = Arg::Signed;
+        arg.i = static_cast<std::int64_t>(value);
+      } else if constexpr (std::is_integral<V>::value && std::is_signed<V>::value) {
+        arg.kind = Arg::Signed;
+        arg.i = value;
+      } else if constexpr (std::is_integral<V>::value) {
+        arg.kind = Arg::Unsigned;
+        arg.u = value;
+      } else if constexpr (std::is_floating_point<V>::value) {
+        arg.kind = Arg::Double;
+        arg.d = value;
+      } else if constexpr (std::is_convertible<T const&, std::string_view>::value) {
+        // copied: the argument may be gone by the time it's described
+        capture(entry, arg, std::string_view{value});
+      } else if constexpr (std::is_pointer<V>::value) {
+        arg.kind = Arg::Pointer;
+        arg.p = value;
+      } else {
+        static_assert(std::is_pointer<V>::value, "error context arguments are numbers, strings or pointers");
+      }
+    }
+  } // namespace detail
+
+  // errno is read, not cleared
+  template <typename... Args> Handle capture(Site const& site, Args const&... args) {
+    static_assert(sizeof...(Args) <= MAX_ARGS, "too many error context arguments");
+    auto& ring = detail::ring;
+    if (ring.left == 0) {
+      ring.next = detail::nextBlock.fetch_add(SLOTS, std::memory_order_relaxed);
+      ring.left = SLOTS;
+    }
+    auto sequence = ring.next++;
+    ring.left--;
+    if (sequence == 0) {
+      sequence = ring.next++;
+      ring.left--;
+    }
+
+    auto& entry = ring.entries[sequence % SLOTS];
+    entry.sequence = sequence;
+    entry.savedErrno = errno;
+    entry.site = site;
+    entry.count = sizeof...(Args);
+    entry.textUsed = 0;
+    [[maybe_unused]] auto i = std::size_t{0};
+    (detail::capture(entry, entry.args[i++], args), ...);
+    return Handle{sequence};
+  }
+
+  inline std::string describe(Handle handle) {
+    if (!handle)
+      return "";
+    auto const& entry = detail::ring.entries[handle.sequence % SLOTS];
+    if (entry.sequence != handle.sequence)
+      return " (context overwritten by newer errors, or captured on another thread)";
+
+    auto out = std::string{" at "};
+    out.append(entry.site.file).append(":").append(std::to_string(entry.site.line));
+    out.append(" in ").append(entry.site.function);
+    if (entry.savedErrno != 0)
+      out.append(", errno ").append(std::to_string(entry.savedErrno)).append(" (").append(std::strerror(entry.savedErrno)).append(")");
+
+    char number[32];
+    for (auto i = std::size_t{0}; i < entry.count; i++) {
+      auto const& arg = entry.args[i];
+      out.append(i == 0 ? ": " : " ");
+      switch (arg.kind) {
+      case detail::Arg::Signed:
+        out.append(std::to_string(arg.i));
+        break;
+      case detail::Arg::Unsigned:
+        out.append(std::to_string(arg.u));
+        break;
+      case detail::Arg::Double:
+        std::snprintf(number, sizeof(number), "%g", arg.d);
+        out.append(number);
+        break;
+      case detail::Arg::Bool:
+        out.append(arg.u != 0 ? "true" : "false");
+        break;
+      case detail::Arg::Text:
+        out.append(entry.text + arg.offset, arg.size);
+        break;
+      case detail::Arg::Pointer:
+        std::snprintf(number, sizeof(number), "%p", arg.p);
+        out.append(number);
+        break;
+      }
+    }
+    return out;
+  }
+} // namespace ErrorContext
+
+#endif //__ERROR_CONTEXT_HPP__
@@ -2,64 +2,234 @@
 #define __EXPECTED_HPP__
 
 #include <cassert>
+#include <cerrno>
+#include <new>
+#include <string>
+#include <type_traits>
 #include <utility>
 
-enum class ErrorCode {
-    NO_ERROR = 0,
+#include "ErrorCode.hpp"
+#include "ErrorContext.hpp"
 
-    EC_INVALID_INPUT = 0x10,
-    // add new error code here
+// Expected<T, E> holds either a T or an error, never both: the error doubles
+// as the discriminant (E{} is "no error", the T is alive) and the T sits in
+// a union, so the error path never constructs one. Release builds
+// (NDEBUG) are as large as a T next to an E and trivially copyable when T
+// and E are, so they're returned in registers. Debug builds also assert that
+// every result was checked with getError() before it's destroyed, which makes
+// them non-trivial: all translation units must agree on NDEBUG. An error
+// made by MakeUnexpected() carries a handle to its context in the union.
+namespace detail {
+#ifdef NDEBUG
+  template <typename T, typename E>
+  constexpr bool TRIVIAL_EXPECTED = std::is_trivially_copyable<T>::value && std::is_trivially_copyable<E>::value;
+#else
+  template <typename T, typename E> constexpr bool TRIVIAL_EXPECTED = false;
+#endif
+
+  template <typename T, typename E, bool Trivial = TRIVIAL_EXPECTED<T, E>> struct ExpectedStorage;
+
+  // everything defaulted: trivial
+  template <typename T, typename E> struct ExpectedStorage<T, E, true> {
+    E error;
+    union {
+      T value;
+      ErrorContext::Handle context;
+    };
+
+    ExpectedStorage(T const& value) : error{}, value{value} {}
+    ExpectedStorage(T&& value) : error{}, value{std::move(value)} {}
+    ExpectedStorage(E error, ErrorContext::Handle context) : error{error}, context{context} {}
+  };
+
+  template <typename T, typename E> struct ExpectedStorage<T, E, false> {
+    E error;
+    union {
+      T value;
+      ErrorContext::Handle context;
+    };
+#ifndef NDEBUG
+    mutable bool checked = false;
+#endif
+
+    ExpectedStorage(T const& value) : error{}, value{value} {}
+    ExpectedStorage(T&& value) : error{}, value{std::move(value)} {}
+    ExpectedStorage(E error, ErrorContext::Handle context) : error{error}, context{context} {}
+
+    ExpectedStorage(ExpectedStorage const& o) : error{o.error} {
+      if (o.error == E{})
+        ::new (&this->value) T(o.value);
+      else
+        this->context = o.context;
+#ifndef NDEBUG
+      this->checked = o.checked;
+#endif
+    }
+
+    ExpectedStorage(ExpectedStorage&& o) : error{o.error} {
+      if (o.error == E{})
+        ::new (&this->value) T(std::move(o.value));
+      else
+        this->context = o.context;
+#ifndef NDEBUG
+      this->checked = o.checked;
+      o.checked = true;
+#endif
+    }
+
+    ExpectedStorage& operator=(ExpectedStorage const& o) {
+      if (this != &o)
+        this->assign(o.error, o.value, o.context);
+#ifndef NDEBUG
+      this->checked = o.checked;
+#endif
+      return *this;
+    }
+
+    ExpectedStorage& operator=(ExpectedStorage&& o) {
+      if (this != &o)
+        this->assign(o.error, std::move(o.value), o.context);
+#ifndef NDEBUG
+      this->checked = o.checked;
+      o.checked = true;
+#endif
+      return *this;
+    }
+
+    ~ExpectedStorage() {
+#ifndef NDEBUG
+      assert(this->checked);
+#endif
+      if (this->error == E{})
+        this->value.~T();
+    }
+
+  private:
+    // `value` or `context`, whichever `error` says is alive, is read
+    template <typename V> void assign(E error, V&& value, ErrorContext::Handle context) {
+      if (this->error == E{} && error == E{}) {
+        this->value = std::forward<V>(value);
+        return;
+      }
+      if (this->error == E{})
+        this->value.~T();
+      if (error == E{})
+        ::new (&this->value) T(std::forward<V>(value));
+      else
+        this->context = context;
+      this->error = error;
+    }
+  };
+
+  template <typename E> std::string describe(E error, ErrorContext::Handle context) {
+    auto out = std::string{};
+    if constexpr (std::is_same<E, ErrorCode>::value)
+      out.append(toString(error)).append(" [").append(category(error)).append("]");
+    else
+      out.append("error ").append(std::to_string(static_cast<long long>(error)));
+    return out.append(ErrorContext::describe(context));
+  }
+} // namespace detail
+
+// what MakeUnexpected() makes, an Expected<T, E> is built from it
+template <typename E> struct Unexpected {
+  E error;
+  ErrorContext::Handle context;
+};
+
+template <typename T, typename E = ErrorCode> struct Expected : private detail::ExpectedStorage<T, E> {
+private:
+  using Storage = detail::ExpectedStorage<T, E>;
+
+  static Storage fromError(E error) {
+    if constexpr (std::is_default_constructible<T>::value) {
+      // E{} isn't an error: a value-initialized T, as it always was
+      if (error == E{})
+        return Storage{T{}};
+    } else {
+      assert(error != E{} && "Expected<T> built from E{} needs a T");
+    }
+    return Storage{error, ErrorContext::Handle{}};
+  }
+
+public:
+  Expected(T const& value) : Storage{value} {}
+  Expected(T&& value) : Storage{std::move(value)} {}
+  Expected(E error) : Storage{fromError(error)} {}
+  Expected(Unexpected<E> const& unexpected) : Storage{unexpected.error, unexpected.context} {
+    assert(unexpected.error != E{});
+  }
+
+  T& get() {
+#ifndef NDEBUG
+    assert(this->checked);
+#endif
+    assert(this->error == E{});
+    return this->value;
+  }
+
+  E getError() const {
+#ifndef NDEBUG
+    this->checked = true;
+#endif
+    return this->error;
+  }
+
+  // formats the error and its context, only call it on an error
+  std::string message() const {
+    return detail::describe(this->getError(), this->error != E{} ? this->context : ErrorContext::Handle{});
+  }
 };
 
-template <typename T, typename E = ErrorCode> struct Expected {
+// only an error, E{} for success: not an Expected<int> in disguise
+template <typename E> struct Expected<void, E> {
 private:
-  T value;
-  E error = {};
+  E error;
+  ErrorContext::Handle context;
+#ifndef NDEBUG
   mutable bool checked = false;
+#endif
 
 public:
+  Expected(E error) : error{error} {}
+  Expected(Unexpected<E> const& unexpected) : error{unexpected.error}, context{unexpected.context} {}
+
+#ifndef NDEBUG
   Expected(Expected const&) = default;
-  Expected(Expected&& o) { this->operator=(std::move(o)); }
+  Expected(Expected&& o) : error{o.error}, context{o.context}, checked{o.checked} { o.checked = true; }
 
   Expected& operator=(Expected const&) = default;
   Expected& operator=(Expected&& o) {
-    this->value = std::move(o.value);
-    this->error = std::move(o.error);
-    this->checked = std::move(o.checked);
+    this->error = o.error;
+    this->context = o.context;
+    this->checked = o.checked;
     o.checked = true;
     return *this;
   }
 
-  Expected(T const& value) : value{value} {}
-  Expected(T&& value) : value{std::move(value)} {}
-  Expected(E error) : error{error} {}
-
   ~Expected() { assert(this->checked); }
-
-  T& get() {
-    assert(this->checked);
-    return value;
-  }
+#endif
 
   E getError() const {
+#ifndef NDEBUG
     this->checked = true;
-    return error;
+#endif
+    return this->error;
   }
-};
 
-template <typename E> struct Expected<void, E> : Expected<int, E> {
-  using Base = Expected<int, E>;
-  using Base::Base;
+  std::string message() const { return detail::describe(this->getError(), this->context); }
+};
 
-  Expected(int) = delete;
+// `return MakeUnexpected(ErrorCode::EC_INVALID_INPUT, "port", port);` records
+// the call site, errno and the arguments with ErrorContext::capture(): no
+// formatting, no I/O, errno is left alone. A class so that the call site can
+// be a default argument after the pack, the deduction guide makes it read as
+// a function call.
+template <typename E, typename... Args> struct MakeUnexpected : Unexpected<E> {
+  MakeUnexpected(E error, Args const&... args, ErrorContext::Site const& site = {__builtin_FILE(), __builtin_LINE(), __builtin_FUNCTION()})
+      : Unexpected<E>{error, ErrorContext::capture(site, args...)} {}
 };
 
-template <typename E, typename... Args>
-static E MakeUnexpected(E&& error, Args&&... args) {
-  if (sizeof...(args) > 0)
-    print_error(std::forward<Args>(args)...);
-  errno = 0;
-  return std::forward<E>(error);
-}
+template <typename E, typename... Args> MakeUnexpected(E, Args const&...) -> MakeUnexpected<E, Args...>;
 
 #endif //__EXPECTED_HPP__
@@ -0,0 +1,168 @@
+#include "AsyncLogger.h"
+#include "Logger.h"
+
+#include <cstring>
+#include <mutex>
+#include <string>
+
+namespace log {
+    namespace async {
+        std::atomic<Backend*> g_backend{nullptr};
+
+        namespace {
+            std::mutex g_control_mutex;
+            Backend g_instance;
+
+            std::size_t roundUpPowerOfTwo(std::size_t n) {
+                auto p = std::size_t{2};
+                while (p < n)
+                    p <<= 1;
+                return p;
+            }
+
+            void appendPrefix(std::string& batch, Timestamp tp, char level) {
+                auto prefix = FixedFormatBuffer<48>{};
+                format(prefix, tp);
+                prefix.append(' ');
+                prefix.append(level);
+                prefix.append(": ", 2);
+                batch.append(prefix.data(), prefix.size());
+            }
+
+            void appendRecord(std::string& batch, Record const& record) {
+                appendPrefix(batch, record.timestamp, record.level);
+                batch.append(record.text, record.size);
+                if (record.level == 'E') {
+                    auto suffix = FixedFormatBuffer<256>{};
+                    join(suffix, "", " [errno: ", record.error, " - ", std::strerror(record.error), "]");
+                    batch.append(suffix.data(), suffix.size());
+                }
+                batch.push_back('\n');
+            }
+
+            void consume(Backend& backend) {
+                auto& queue = *backend.queue;
+                auto batch = std::string{};
+                batch.reserve(backend.options.batchSize * 128);
+                auto reported = std::uint64_t{0};
+
+                while (true) {
+                    // read before draining: everything published before stop() set it is seen below
+                    auto stopping = backend.stopping.load(std::memory_order_acquire);
+                    auto count = std::size_t{0};
+                    while (count < backend.options.batchSize) {
+                        auto record = queue.front();
+                        if (record == nullptr)
+                            break;
+                        appendRecord(batch, *record);
+                        queue.pop();
+                        count++;
+                    }
+
+                    auto dropped = backend.dropped.load(std::memory_order_relaxed);
+                    if (dropped != reported) {
+                        appendPrefix(batch, Timestamp::now(), 'W');
+                        batch.append(std::to_string(dropped - reported));
+                        batch.append(" log records dropped\n");
+                        reported = dropped;
+                    }
+
+                    if (!batch.empty()) {
+                        sink().write(batch.data(), batch.size());
+                        batch.clear();
+                    }
+
+                    if (count == 0) {
+                        sink().flush();
+                        if (stopping)
+                            break;
+                        std::this_thread::sleep_for(backend.options.idleSleep);
+                    }
+                }
+            }
+
+            // flush-on-shutdown: static destruction drains whatever is still queued
+            struct ShutdownGuard {
+                ~ShutdownGuard() { stop(); }
+            } g_shutdown_guard;
+        }
+
+        RecordQueue::RecordQueue(std::size_t capacity)
+            : slots{new Slot[roundUpPowerOfTwo(capacity)]},
+            mask{roundUpPowerOfTwo(capacity) - 1} {
+                for (std::size_t i = 0; i <= this->mask; i++)
+                    this->slots[i].sequence.store(i, std::memory_order_relaxed);
+            }
+
+        Record* RecordQueue::tryClaim(std::size_t& pos) {
+            pos = this->enqueuePos.load(std::memory_order_relaxed);
+            while (true) {
+                auto& slot = this->slots[pos & this->mask];
+                auto seq = slot.sequence.load(std::memory_order_acquire);
+                auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+                if (diff == 0) {
+                    if (this->enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        return &slot.record;
+                } else if (diff < 0) {
+                    return nullptr;
+                } else {
+                    pos = this->enqueuePos.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        void RecordQueue::publish(std::size_t pos) {
+            this->slots[pos & this->mask].sequence.store(pos + 1, std::memory_order_release);
+        }
+
+        Record* RecordQueue::front() {
+            auto& slot = this->slots[this->dequeuePos & this->mask];
+            if (slot.sequence.load(std::memory_order_acquire) != this->dequeuePos + 1)
+                return nullptr;
+            return &slot.record;
+        }
+
+        void RecordQueue::pop() {
+            auto& slot = this->slots[this->dequeuePos & this->mask];
+            slot.sequence.store(this->dequeuePos + this->mask + 1, std::memory_order_release);
+            this->dequeuePos++;
+        }
+
+        void start(Options const& options) {
+            auto lock = std::lock_guard<std::mutex>{g_control_mutex};
+            if (g_backend.load(std::memory_order_relaxed) != nullptr)
+                return;
+
+            // stop() left no producer inside submit() and g_backend is still null,
+            // so the queue of the previous session is unused: reuse it when it fits
+            auto capacity = roundUpPowerOfTwo(options.capacity);
+            if (g_instance.queue == nullptr || g_instance.options.capacity != capacity)
+                g_instance.queue = std::make_unique<RecordQueue>(capacity);
+            g_instance.options = options;
+            g_instance.options.capacity = capacity;
+            g_instance.dropped.store(0, std::memory_order_relaxed);
+            g_instance.stopping.store(false, std::memory_order_relaxed);
+            g_instance.consumer = std::thread{consume, std::ref(g_instance)};
+            g_backend.store(&g_instance, std::memory_order_release);
+        }
+
+        void stop() {
+            auto lock = std::lock_guard<std::mutex>{g_control_mutex};
+            if (g_backend.load(std::memory_order_relaxed) == nullptr)
+                return;
+
+            // new calls go back to the synchronous path; calls already past the
+            // check finish publishing (the consumer still drains) before the
+            // consumer is told to stop, so every accepted record is written
+            g_backend.store(nullptr, std::memory_order_seq_cst);
+            while (g_instance.producers.load(std::memory_order_seq_cst) != 0)
+                std::this_thread::yield();
+            g_instance.stopping.store(true, std::memory_order_release);
+            g_instance.consumer.join();
+        }
+
+        std::uint64_t dropped() {
+            return g_instance.dropped.load(std::memory_order_relaxed);
+        }
+    }
+}
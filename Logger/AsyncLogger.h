@@ -0,0 +1,141 @@
+#ifndef __LOGGER_ASYNC_LOGGER_H__
+#define __LOGGER_ASYNC_LOGGER_H__
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+#include "Format.h"
+
+namespace log {
+    namespace async {
+        // what a producer does when the ring is full
+        enum class OverflowPolicy {
+            BLOCK, // spin/yield until the consumer frees a slot
+            DROP,  // discard the newest record and count it
+        };
+
+        // A record holds Record::TEXT_SIZE bytes of text; longer lines (the synchronous
+        // path allows 4 KiB) are cut and end with "..." while async mode is on.
+        struct Options {
+            std::size_t capacity = 8192; // rounded up to a power of two
+            OverflowPolicy policy = OverflowPolicy::BLOCK;
+            std::size_t batchSize = 256; // records written per stream write
+            std::chrono::microseconds idleSleep{200};
+        };
+
+        struct Record {
+            static constexpr std::size_t TEXT_SIZE = 232;
+            static constexpr char const* TRUNCATED = "...";
+
+            Timestamp timestamp; // raw, converted by the consumer
+            int error = 0;
+            char level = 'I';
+            std::uint16_t size = 0;
+            char text[TEXT_SIZE];
+        };
+
+        // bounded MPSC ring (Vyukov-style sequence numbers per slot), producers
+        // never take a lock and the single consumer never blocks them
+        class RecordQueue {
+            public:
+                explicit RecordQueue(std::size_t capacity);
+
+                Record* tryClaim(std::size_t& pos);
+                void publish(std::size_t pos);
+
+                Record* front();
+                void pop();
+
+            private:
+                struct alignas(64) Slot {
+                    std::atomic<std::size_t> sequence;
+                    Record record;
+                };
+
+                std::unique_ptr<Slot[]> slots;
+                std::size_t mask;
+                alignas(64) std::atomic<std::size_t> enqueuePos{0};
+                alignas(64) std::size_t dequeuePos = 0;
+        };
+
+        struct Backend {
+            Options options;
+            std::unique_ptr<RecordQueue> queue; // only replaced while no producer is inside submit()
+            std::atomic<std::uint64_t> dropped{0};
+            std::atomic<std::size_t> producers{0}; // submit() calls between claim and publish
+            std::atomic<bool> stopping{false};
+            std::thread consumer;
+        };
+
+        extern std::atomic<Backend*> g_backend;
+
+        // starts the consumer thread, log::info/warn/error are routed to it until stop(),
+        // batches go to whatever log::sink() is current when they are written
+        void start(Options const& options = {});
+
+        // drains every record submitted before the call, flushes and joins the consumer
+        void stop();
+
+        std::uint64_t dropped();
+
+        inline bool isRunning() {
+            return g_backend.load(std::memory_order_acquire) != nullptr;
+        }
+
+        // returns false if the record must go through the synchronous path instead
+        template <typename F>
+            bool submit(char level, Timestamp now, int error, F&& write) {
+                auto backend = g_backend.load(std::memory_order_acquire);
+                if (backend == nullptr)
+                    return false;
+
+                // stop() clears g_backend then waits for producers to drop to 0,
+                // so either it sees us or we see it stopped
+                backend->producers.fetch_add(1, std::memory_order_seq_cst);
+                if (g_backend.load(std::memory_order_seq_cst) != backend) {
+                    backend->producers.fetch_sub(1, std::memory_order_release);
+                    return false;
+                }
+
+                auto& queue = *backend->queue;
+                auto pos = std::size_t{0};
+                auto record = queue.tryClaim(pos);
+                while (record == nullptr) {
+                    if (backend->options.policy == OverflowPolicy::DROP) {
+                        backend->dropped.fetch_add(1, std::memory_order_relaxed);
+                        backend->producers.fetch_sub(1, std::memory_order_release);
+                        return true;
+                    }
+                    // the consumer keeps draining until every producer is out
+                    std::this_thread::yield();
+                    record = queue.tryClaim(pos);
+                }
+
+                auto out = FormatBuffer{record->text, Record::TEXT_SIZE};
+                write(out);
+                auto size = out.size();
+                // a line of exactly TEXT_SIZE bytes is whole
+                if (out.truncated()) {
+                    size = std::min(size, Record::TEXT_SIZE - 3);
+                    std::memcpy(record->text + size, Record::TRUNCATED, 3);
+                    size += 3;
+                }
+
+                record->timestamp = now;
+                record->error = error;
+                record->level = level;
+                record->size = static_cast<std::uint16_t>(size);
+                queue.publish(pos);
+                backend->producers.fetch_sub(1, std::memory_order_release);
+                return true;
+            }
+    }
+}
+
+#endif //__LOGGER_ASYNC_LOGGER_H__
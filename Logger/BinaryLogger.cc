@@ -0,0 +1,419 @@
+#include "BinaryLogger.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+namespace log {
+    namespace binary {
+        namespace {
+            static constexpr std::size_t BUFFER_SIZE = 64 * 1024;
+
+            struct SiteEntry {
+                Site const* site;
+                char const* format;
+                ArgType const* types;
+                std::size_t argc;
+            };
+
+            std::mutex g_mutex;
+            std::FILE* g_file = nullptr;
+            std::atomic<bool> g_open{false};
+            std::vector<SiteEntry> g_sites; // index + 1 is the site id
+            Decoder g_text_decoder;
+
+            void writeLocked(char const* data, std::size_t size) {
+                if (g_file != nullptr)
+                    std::fwrite(data, 1, size, g_file);
+            }
+
+            void writeDescriptorLocked(std::uint32_t id, SiteEntry const& entry) {
+                auto descriptor = std::string{};
+                auto append = [&descriptor](auto value) {
+                    descriptor.append(reinterpret_cast<char const*>(&value), sizeof(value));
+                };
+
+                auto format = std::string_view{entry.format};
+                auto file = std::string_view{entry.site->file};
+                append(TAG_DESCRIPTOR);
+                append(id);
+                append(entry.site->level);
+                append(static_cast<std::uint8_t>(entry.argc));
+                descriptor.append(reinterpret_cast<char const*>(entry.types), entry.argc);
+                append(static_cast<std::uint16_t>(format.size()));
+                descriptor.append(format);
+                append(static_cast<std::uint16_t>(file.size()));
+                descriptor.append(file);
+                append(static_cast<std::uint32_t>(entry.site->line));
+                writeLocked(descriptor.data(), descriptor.size());
+            }
+
+            // Each thread fills its own buffer; the owner holds `busy` while it
+            // encodes, close() and flush() take it to write the buffer out.
+            // Lock order: g_buffers_mutex, then busy, then g_mutex.
+            struct ThreadBuffer;
+            std::mutex g_buffers_mutex;
+            std::vector<ThreadBuffer*> g_buffers;
+
+            struct ThreadBuffer {
+                char data[BUFFER_SIZE];
+                std::size_t used = 0;
+                std::string oversized; // a record larger than data, until commit()
+                std::atomic<bool> busy{false};
+
+                ThreadBuffer() {
+                    auto lock = std::lock_guard<std::mutex>{g_buffers_mutex};
+                    g_buffers.push_back(this);
+                }
+
+                void acquire() {
+                    while (this->busy.exchange(true, std::memory_order_acquire))
+                        std::this_thread::yield();
+                }
+
+                void release() { this->busy.store(false, std::memory_order_release); }
+
+                // with busy held
+                void flush() {
+                    if (this->used == 0)
+                        return;
+                    auto lock = std::lock_guard<std::mutex>{g_mutex};
+                    writeLocked(this->data, this->used);
+                    this->used = 0;
+                }
+
+                ~ThreadBuffer() {
+                    auto lock = std::lock_guard<std::mutex>{g_buffers_mutex};
+                    this->acquire();
+                    this->flush();
+                    this->release();
+                    g_buffers.erase(std::find(g_buffers.begin(), g_buffers.end(), this));
+                }
+            };
+
+            thread_local ThreadBuffer t_buffer;
+
+            void flushBuffers() {
+                auto lock = std::lock_guard<std::mutex>{g_buffers_mutex};
+                for (auto buffer : g_buffers) {
+                    buffer->acquire();
+                    buffer->flush();
+                    buffer->release();
+                }
+            }
+
+            template <typename V> char const* get(char const* p, V& value) {
+                std::memcpy(&value, p, sizeof(value));
+                return p + sizeof(value);
+            }
+
+            void appendArg(std::string& out, ArgType type, char const*& p, char const* end) {
+                char text[32];
+                auto result = std::to_chars_result{text, {}};
+                switch (type) {
+                case ArgType::BOOL:
+                case ArgType::CHAR: {
+                    auto c = char{};
+                    p = get(p, c);
+                    if (type == ArgType::CHAR)
+                        out.push_back(c);
+                    else
+                        out.push_back(c ? '1' : '0');
+                    return;
+                }
+                case ArgType::INT32: {
+                    auto v = std::int32_t{};
+                    p = get(p, v);
+                    result = std::to_chars(text, text + sizeof(text), v);
+                    break;
+                }
+                case ArgType::UINT32: {
+                    auto v = std::uint32_t{};
+                    p = get(p, v);
+                    result = std::to_chars(text, text + sizeof(text), v);
+                    break;
+                }
+                case ArgType::INT64: {
+                    auto v = std::int64_t{};
+                    p = get(p, v);
+                    result = std::to_chars(text, text + sizeof(text), v);
+                    break;
+                }
+                case ArgType::UINT64: {
+                    auto v = std::uint64_t{};
+                    p = get(p, v);
+                    result = std::to_chars(text, text + sizeof(text), v);
+                    break;
+                }
+                case ArgType::DOUBLE: {
+                    auto v = 0.0;
+                    p = get(p, v);
+                    result = std::to_chars(text, text + sizeof(text), v);
+                    break;
+                }
+                case ArgType::STRING: {
+                    auto size = std::uint32_t{};
+                    p = get(p, size);
+                    size = static_cast<std::uint32_t>(std::min<std::size_t>(size, end - p));
+                    out.append(p, size);
+                    p += size;
+                    return;
+                }
+                }
+                out.append(text, result.ptr);
+            }
+
+            std::size_t argSize(ArgType type, char const* p, char const* end) {
+                switch (type) {
+                case ArgType::BOOL:
+                case ArgType::CHAR:
+                    return 1;
+                case ArgType::INT32:
+                case ArgType::UINT32:
+                    return 4;
+                case ArgType::STRING: {
+                    if (end - p < 4)
+                        return 5; // anything larger than what is left
+                    auto size = std::uint32_t{};
+                    get(p, size);
+                    return 4 + size;
+                }
+                default:
+                    return 8;
+                }
+            }
+        }
+
+        bool open(char const* path) {
+#ifdef LOG_USE_TSC_CLOCK
+            // records are stored in ns: calibrate here rather than in the first LOG_BIN_* call
+            TscClock::calibrate();
+#endif
+
+            // records of the previous stream stay in it
+            flushBuffers();
+
+            auto lock = std::lock_guard<std::mutex>{g_mutex};
+            if (g_file != nullptr)
+                std::fclose(g_file);
+
+            g_file = std::fopen(path, "wb");
+            if (g_file == nullptr) {
+                g_open.store(false, std::memory_order_release);
+                return false;
+            }
+
+            writeLocked(MAGIC, sizeof(MAGIC));
+            for (std::size_t i = 0; i < g_sites.size(); i++)
+                writeDescriptorLocked(static_cast<std::uint32_t>(i + 1), g_sites[i]);
+            g_open.store(true, std::memory_order_release);
+            return true;
+        }
+
+        void close() {
+            // writers that see g_open still set hold their buffer, flushBuffers() waits for them
+            g_open.store(false, std::memory_order_seq_cst);
+            flushBuffers();
+
+            auto lock = std::lock_guard<std::mutex>{g_mutex};
+            if (g_file != nullptr) {
+                std::fclose(g_file);
+                g_file = nullptr;
+            }
+        }
+
+        void flush() {
+            flushBuffers();
+
+            auto lock = std::lock_guard<std::mutex>{g_mutex};
+            if (g_file != nullptr)
+                std::fflush(g_file);
+        }
+
+        std::uint32_t registerSite(Site const& site, std::atomic<std::uint32_t>& siteId,
+                char const* format, ArgType const* types, std::size_t argc) {
+            auto lock = std::lock_guard<std::mutex>{g_mutex};
+            auto id = siteId.load(std::memory_order_relaxed);
+            if (id != 0)
+                return id;
+
+            g_sites.push_back({&site, format, types, argc});
+            id = static_cast<std::uint32_t>(g_sites.size());
+            writeDescriptorLocked(id, g_sites.back());
+
+            auto formatCopy = std::string{format};
+            g_text_decoder.addDescriptor(id, site.level, std::move(formatCopy),
+                    std::vector<ArgType>(types, types + argc));
+
+            siteId.store(id, std::memory_order_release);
+            return id;
+        }
+
+        char* reserve(std::size_t size) {
+            auto& buffer = t_buffer;
+            buffer.acquire();
+            if (!g_open.load(std::memory_order_seq_cst)) {
+                buffer.release();
+                return nullptr;
+            }
+
+            if (buffer.used + size > BUFFER_SIZE)
+                buffer.flush();
+            if (size > BUFFER_SIZE) {
+                buffer.oversized.resize(size);
+                return &buffer.oversized[0];
+            }
+            auto p = buffer.data + buffer.used;
+            buffer.used += size;
+            return p;
+        }
+
+        void commit() {
+            auto& buffer = t_buffer;
+            if (!buffer.oversized.empty()) {
+                // the buffer was flushed by reserve(), records stay in order
+                auto lock = std::lock_guard<std::mutex>{g_mutex};
+                writeLocked(buffer.oversized.data(), buffer.oversized.size());
+                buffer.oversized.clear();
+            }
+            buffer.release();
+        }
+
+        void writeText(std::uint32_t id, char const* args, std::size_t size,
+                Timestamp now, int error) {
+            thread_local std::string message;
+            message.clear();
+            auto level = char{};
+            {
+                auto lock = std::lock_guard<std::mutex>{g_mutex};
+                level = g_text_decoder.formatMessage(id, args, size, message);
+            }
+            detail::emitAt(level, now, error, 0, std::string_view{message});
+        }
+
+        void Decoder::addDescriptor(std::uint32_t id, char level, std::string format, std::vector<ArgType> types) {
+            this->descriptors[id] = Descriptor{level, std::move(format), std::move(types)};
+        }
+
+        void Decoder::format(std::uint32_t id, std::int64_t ns, int error, char const* args, std::size_t size,
+                std::string& out) const {
+            char prefix[48];
+            auto it = this->descriptors.find(id);
+            auto level = it == this->descriptors.end() ? '?' : it->second.level;
+            auto n = std::snprintf(prefix, sizeof(prefix), "[%.4f] %c: ", ns / 1e9, level);
+            out.append(prefix, static_cast<std::size_t>(n));
+
+            this->formatMessage(id, args, size, out);
+            if (level == 'E') {
+                out.append(" [errno: ");
+                out.append(std::to_string(error));
+                out.append(" - ");
+                out.append(std::strerror(error));
+                out.append("]");
+            }
+            out.push_back('\n');
+        }
+
+        char Decoder::formatMessage(std::uint32_t id, char const* args, std::size_t size, std::string& out) const {
+            auto it = this->descriptors.find(id);
+            if (it == this->descriptors.end()) {
+                out.append("<unknown call site ");
+                out.append(std::to_string(id));
+                out.append(">");
+                return '?';
+            }
+
+            auto const& descriptor = it->second;
+            auto p = args;
+            auto end = args + size;
+            auto arg = std::size_t{0};
+            auto format = std::string_view{descriptor.format};
+            for (std::size_t i = 0; i < format.size(); i++) {
+                if (format[i] == '{' && i + 1 < format.size() && format[i + 1] == '}' &&
+                        arg < descriptor.types.size()) {
+                    appendArg(out, descriptor.types[arg++], p, end);
+                    i++;
+                } else {
+                    out.push_back(format[i]);
+                }
+            }
+            // arguments without a placeholder are joined like log::join does
+            while (arg < descriptor.types.size()) {
+                out.push_back(' ');
+                appendArg(out, descriptor.types[arg++], p, end);
+            }
+            return descriptor.level;
+        }
+
+        std::size_t Decoder::decode(char const* data, std::size_t size, std::string& out) {
+            auto p = data;
+            auto end = data + size;
+            auto need = [&p, end](std::size_t n) { return static_cast<std::size_t>(end - p) >= n; };
+
+            if (!need(1))
+                return 0;
+            auto tag = *p++;
+
+            if (tag == TAG_DESCRIPTOR) {
+                if (!need(4 + 1 + 1))
+                    return 0;
+                auto id = std::uint32_t{};
+                auto level = char{};
+                auto argc = std::uint8_t{};
+                p = get(p, id);
+                p = get(p, level);
+                p = get(p, argc);
+                if (!need(argc + 2))
+                    return 0;
+                auto types = std::vector<ArgType>(argc);
+                std::memcpy(types.data(), p, argc);
+                p += argc;
+                auto formatSize = std::uint16_t{};
+                p = get(p, formatSize);
+                if (!need(formatSize + 2u))
+                    return 0;
+                auto format = std::string(p, formatSize);
+                p += formatSize;
+                auto fileSize = std::uint16_t{};
+                p = get(p, fileSize);
+                if (!need(fileSize + 4u))
+                    return 0;
+                p += fileSize + 4;
+                this->addDescriptor(id, level, std::move(format), std::move(types));
+                return static_cast<std::size_t>(p - data);
+            }
+
+            if (tag != TAG_RECORD || !need(4 + 8))
+                return 0;
+
+            auto id = std::uint32_t{};
+            auto ns = std::int64_t{};
+            p = get(p, id);
+            p = get(p, ns);
+
+            auto it = this->descriptors.find(id);
+            if (it == this->descriptors.end())
+                return 0;
+
+            auto error = std::int32_t{0};
+            if (it->second.level == 'E') {
+                if (!need(4))
+                    return 0;
+                p = get(p, error);
+            }
+
+            auto args = p;
+            for (auto type : it->second.types) {
+                auto n = argSize(type, p, end);
+                if (!need(n))
+                    return 0;
+                p += n;
+            }
+
+            this->format(id, ns, error, args, static_cast<std::size_t>(p - args), out);
+            return static_cast<std::size_t>(p - data);
+        }
+    }
+}
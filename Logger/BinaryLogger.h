@@ -0,0 +1,219 @@
+#ifndef __LOGGER_BINARY_LOGGER_H__
+#define __LOGGER_BINARY_LOGGER_H__
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "Logger.h"
+
+// Deferred formatting: a call site only copies its raw argument bytes and a
+// timestamp into a per-thread buffer, the text is produced offline by logdecode.
+//
+//     LOG_BIN_INFO("a = {}", a);
+//     LOG_BIN_ERROR("p is {} and b is {}", p, b);
+//
+// Every site owns a static descriptor (level, format, file, line, argument
+// types) that is written once to the stream the first time the site runs.
+// Levels are filtered like the LOG_* macros of Filter.h.
+#define LOG_BINARY(level, ...) \
+    do { \
+        if constexpr (::log::isCompiledIn(::log::levelOf(level))) { \
+            if (::log::isEnabled(::log::levelOf(level))) { \
+                static constexpr ::log::binary::Site log_binary_site_{level, __FILE__, __LINE__}; \
+                static std::atomic<std::uint32_t> log_binary_site_id_{0}; \
+                ::log::binary::write(log_binary_site_, log_binary_site_id_, __VA_ARGS__); \
+            } \
+        } \
+    } while (0)
+
+#define LOG_BIN_INFO(...) LOG_BINARY('I', __VA_ARGS__)
+#define LOG_BIN_WARN(...) LOG_BINARY('W', __VA_ARGS__)
+#define LOG_BIN_ERROR(...) LOG_BINARY('E', __VA_ARGS__)
+
+namespace log {
+    namespace binary {
+        enum class ArgType : std::uint8_t {
+            BOOL = 1,
+            CHAR,
+            INT32,
+            UINT32,
+            INT64,
+            UINT64,
+            DOUBLE,
+            STRING,
+        };
+
+        // stream layout, all integers in host byte order:
+        //   header      "LOGBIN01"
+        //   descriptor  'D' u32 id, u8 level, u8 argc, u8 types[argc],
+        //               u16 len, format, u16 len, file, u32 line
+        //   record      'R' u32 id, i64 ns since g_ref_point, [i32 errno if 'E'], args
+        //   args        fixed-size values, strings as u32 len + bytes
+        static constexpr char MAGIC[8] = {'L', 'O', 'G', 'B', 'I', 'N', '0', '1'};
+        static constexpr char TAG_DESCRIPTOR = 'D';
+        static constexpr char TAG_RECORD = 'R';
+        static constexpr std::size_t MAX_STRING_SIZE = 4096;
+
+        struct Site {
+            char level;
+            char const* file;
+            int line;
+        };
+
+        template <typename T> constexpr ArgType argTypeOf() {
+            using U = std::decay_t<T>;
+            if constexpr (std::is_same_v<U, bool>)
+                return ArgType::BOOL;
+            else if constexpr (std::is_same_v<U, char>)
+                return ArgType::CHAR;
+            else if constexpr (std::is_integral_v<U> && std::is_signed_v<U>)
+                return sizeof(U) <= 4 ? ArgType::INT32 : ArgType::INT64;
+            else if constexpr (std::is_integral_v<U>)
+                return sizeof(U) <= 4 ? ArgType::UINT32 : ArgType::UINT64;
+            else if constexpr (std::is_enum_v<U>)
+                return argTypeOf<std::underlying_type_t<U>>();
+            else if constexpr (std::is_floating_point_v<U>)
+                return ArgType::DOUBLE;
+            else if constexpr (std::is_convertible_v<U, std::string_view>)
+                return ArgType::STRING;
+            else
+                static_assert(sizeof(U) == 0, "type cannot be logged in binary mode");
+        }
+
+        template <typename... Ts> struct ArgTypeList {
+            static constexpr ArgType values[sizeof...(Ts) + 1] = {argTypeOf<Ts>()..., ArgType{}};
+        };
+
+        template <typename T> std::size_t encodedSize(T const& value) {
+            switch (argTypeOf<T>()) {
+            case ArgType::BOOL:
+            case ArgType::CHAR:
+                return 1;
+            case ArgType::INT32:
+            case ArgType::UINT32:
+                return 4;
+            case ArgType::STRING:
+                if constexpr (std::is_convertible_v<T, std::string_view>)
+                    return 4 + std::min(std::string_view{value}.size(), MAX_STRING_SIZE);
+                return 0;
+            default:
+                return 8;
+            }
+        }
+
+        template <typename V> char* put(char* p, V value) {
+            std::memcpy(p, &value, sizeof(value));
+            return p + sizeof(value);
+        }
+
+        template <typename T> char* encode(char* p, T const& value) {
+            constexpr auto type = argTypeOf<T>();
+            if constexpr (type == ArgType::STRING) {
+                auto str = std::string_view{value};
+                auto size = static_cast<std::uint32_t>(std::min(str.size(), MAX_STRING_SIZE));
+                p = put(p, size);
+                std::memcpy(p, str.data(), size);
+                return p + size;
+            } else if constexpr (type == ArgType::BOOL || type == ArgType::CHAR) {
+                return put(p, static_cast<char>(value));
+            } else if constexpr (type == ArgType::INT32) {
+                return put(p, static_cast<std::int32_t>(value));
+            } else if constexpr (type == ArgType::UINT32) {
+                return put(p, static_cast<std::uint32_t>(value));
+            } else if constexpr (type == ArgType::INT64) {
+                return put(p, static_cast<std::int64_t>(value));
+            } else if constexpr (type == ArgType::UINT64) {
+                return put(p, static_cast<std::uint64_t>(value));
+            } else {
+                return put(p, static_cast<double>(value));
+            }
+        }
+
+        // opens the binary stream, descriptors of sites that already ran are replayed
+        bool open(char const* path);
+
+        // writes the buffered records of every thread, then closes the stream
+        void close();
+
+        // writes the buffered records of every thread and flushes the stream
+        void flush();
+
+        std::uint32_t registerSite(Site const& site, std::atomic<std::uint32_t>& siteId,
+                char const* format, ArgType const* types, std::size_t argc);
+
+        // room for `size` bytes in the calling thread's buffer, nullptr when no stream
+        // is open; otherwise the buffer is held until commit(). Records larger than the
+        // buffer go to separate storage written on commit().
+        char* reserve(std::size_t size);
+        void commit();
+
+        // formats a record as log::info & co do when no binary stream is open:
+        // async backend or log::sink()
+        void writeText(std::uint32_t id, char const* args, std::size_t size,
+                Timestamp now, int error);
+
+        template <typename... Ts>
+            void write(Site const& site, std::atomic<std::uint32_t>& siteId, char const* format, Ts const&... as) {
+                auto now = Timestamp::now();
+                auto error = errno;
+
+                auto id = siteId.load(std::memory_order_acquire);
+                if (id == 0)
+                    id = registerSite(site, siteId, format, ArgTypeList<Ts...>::values, sizeof...(Ts));
+
+                auto argsSize = (std::size_t{0} + ... + encodedSize(as));
+                auto size = 1 + 4 + 8 + (site.level == 'E' ? 4 : 0) + argsSize;
+
+                auto p = reserve(size);
+                if (p == nullptr) {
+                    auto args = std::string(argsSize, '\0');
+                    [[maybe_unused]] auto q = &args[0];
+                    ((q = encode(q, as)), ...);
+                    writeText(id, args.data(), args.size(), now, error);
+                    return;
+                }
+
+                p = put(p, TAG_RECORD);
+                p = put(p, id);
+                p = put(p, static_cast<std::int64_t>(now.since(g_ref_point).count()));
+                if (site.level == 'E')
+                    p = put(p, static_cast<std::int32_t>(error));
+                ((p = encode(p, as)), ...);
+                commit();
+            }
+
+        // turns a binary stream back into the `[elapsed] I: ...` text of log::info & co
+        class Decoder {
+            public:
+                // decodes one descriptor or record, returns the bytes consumed or 0 when
+                // `size` does not hold a complete entry; text is appended to `out`
+                std::size_t decode(char const* data, std::size_t size, std::string& out);
+
+                void addDescriptor(std::uint32_t id, char level, std::string format, std::vector<ArgType> types);
+                void format(std::uint32_t id, std::int64_t ns, int error, char const* args, std::size_t size,
+                        std::string& out) const;
+                // the message alone, no prefix, errno or newline; returns the level
+                char formatMessage(std::uint32_t id, char const* args, std::size_t size, std::string& out) const;
+
+            private:
+                struct Descriptor {
+                    char level;
+                    std::string format;
+                    std::vector<ArgType> types;
+                };
+
+                std::unordered_map<std::uint32_t, Descriptor> descriptors;
+        };
+    }
+}
+
+#endif //__LOGGER_BINARY_LOGGER_H__
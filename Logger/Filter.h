@@ -0,0 +1,132 @@
+#ifndef __LOGGER_FILTER_H__
+#define __LOGGER_FILTER_H__
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Lowest level compiled in: 0 info, 1 warn, 2 error, 3 nothing. The LOG_* macros
+// below a disabled level expand to nothing, arguments are not evaluated either.
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 0
+#endif
+
+#define LOG_AT_(level, fn, ...) \
+    do { \
+        if constexpr (::log::isCompiledIn(level)) { \
+            if (::log::isEnabled(level)) \
+                fn(__VA_ARGS__); \
+        } \
+    } while (0)
+
+#define LOG_INFO(...) LOG_AT_(::log::Level::INFO, ::log::info, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT_(::log::Level::WARN, ::log::warn, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT_(::log::Level::ERROR, ::log::error, __VA_ARGS__)
+
+// the first call and then one call out of n, emitted lines carry the
+// number of calls skipped since the previous one
+#define LOG_SAMPLED_(level, limiter, ...) \
+    do { \
+        if constexpr (::log::isCompiledIn(level)) { \
+            if (::log::isEnabled(level)) { \
+                static limiter; \
+                auto log_suppressed_ = std::uint64_t{0}; \
+                if (log_limiter_.allow(log_suppressed_)) \
+                    ::log::detail::emit(::log::levelChar(level), errno, log_suppressed_, __VA_ARGS__); \
+            } \
+        } \
+    } while (0)
+
+#define LOG_INFO_EVERY_N(n, ...) LOG_SAMPLED_(::log::Level::INFO, ::log::Sampler log_limiter_{n}, __VA_ARGS__)
+#define LOG_WARN_EVERY_N(n, ...) LOG_SAMPLED_(::log::Level::WARN, ::log::Sampler log_limiter_{n}, __VA_ARGS__)
+#define LOG_ERROR_EVERY_N(n, ...) LOG_SAMPLED_(::log::Level::ERROR, ::log::Sampler log_limiter_{n}, __VA_ARGS__)
+
+// at most n lines per second from the call site
+#define LOG_INFO_RATE(n, ...) LOG_SAMPLED_(::log::Level::INFO, ::log::RateLimiter log_limiter_{n}, __VA_ARGS__)
+#define LOG_WARN_RATE(n, ...) LOG_SAMPLED_(::log::Level::WARN, ::log::RateLimiter log_limiter_{n}, __VA_ARGS__)
+#define LOG_ERROR_RATE(n, ...) LOG_SAMPLED_(::log::Level::ERROR, ::log::RateLimiter log_limiter_{n}, __VA_ARGS__)
+
+namespace log {
+    enum class Level : int {
+        INFO = 0,
+        WARN = 1,
+        ERROR = 2,
+        NONE = 3,
+    };
+
+    constexpr bool isCompiledIn(Level level) {
+        return static_cast<int>(level) >= LOG_MIN_LEVEL;
+    }
+
+    constexpr char levelChar(Level level) {
+        return level == Level::ERROR ? 'E' : level == Level::WARN ? 'W' : 'I';
+    }
+
+    constexpr Level levelOf(char level) {
+        return level == 'E' ? Level::ERROR : level == 'W' ? Level::WARN : Level::INFO;
+    }
+
+    extern std::atomic<Level> g_level;
+
+    // runtime threshold, can be changed from any thread while logging
+    inline void setLevel(Level level) {
+        g_level.store(level, std::memory_order_relaxed);
+    }
+
+    inline Level level() {
+        return g_level.load(std::memory_order_relaxed);
+    }
+
+    inline bool isEnabled(Level level) {
+        return isCompiledIn(level) &&
+            static_cast<int>(level) >= static_cast<int>(g_level.load(std::memory_order_relaxed));
+    }
+
+    class Sampler {
+        public:
+            explicit Sampler(std::uint64_t n) : n{n == 0 ? 1 : n} {}
+
+            bool allow(std::uint64_t& suppressed) {
+                auto call = this->calls.fetch_add(1, std::memory_order_relaxed);
+                if (call % this->n != 0)
+                    return false;
+                suppressed = call == 0 ? 0 : this->n - 1;
+                return true;
+            }
+
+        private:
+            std::uint64_t const n;
+            std::atomic<std::uint64_t> calls{0};
+    };
+
+    class RateLimiter {
+        public:
+            explicit RateLimiter(std::uint64_t perSecond) : perSecond{perSecond} {}
+
+            bool allow(std::uint64_t& suppressed) {
+                auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+                auto start = this->windowStart.load(std::memory_order_relaxed);
+                if (now - start >= WINDOW &&
+                        this->windowStart.compare_exchange_strong(start, now, std::memory_order_relaxed))
+                    this->count.store(0, std::memory_order_relaxed);
+
+                if (this->count.fetch_add(1, std::memory_order_relaxed) >= this->perSecond) {
+                    this->skipped.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+                suppressed = this->skipped.exchange(0, std::memory_order_relaxed);
+                return true;
+            }
+
+        private:
+            static constexpr std::chrono::steady_clock::rep WINDOW =
+                std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::seconds{1}).count();
+
+            std::uint64_t const perSecond;
+            std::atomic<std::chrono::steady_clock::rep> windowStart{0};
+            std::atomic<std::uint64_t> count{0};
+            std::atomic<std::uint64_t> skipped{0};
+    };
+}
+
+#endif //__LOGGER_FILTER_H__
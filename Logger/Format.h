@@ -0,0 +1,289 @@
+#ifndef __LOGGER_FORMAT_H__
+#define __LOGGER_FORMAT_H__
+
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "../Clock/TscClock.hpp"
+
+namespace log {
+    // source of log timestamps, LOG_USE_TSC_CLOCK trades steady_clock's vDSO call for rdtsc
+#ifdef LOG_USE_TSC_CLOCK
+    using Clock = TscClock;
+#else
+    using Clock = std::chrono::steady_clock;
+#endif
+
+    // Raw reading taken by each log call; it becomes time only when a line is
+    // formatted. TSC ticks under LOG_USE_TSC_CLOCK (TscClock calibrates on the
+    // first conversion, not on the first read), steady_clock nanoseconds otherwise.
+    struct Timestamp {
+        std::uint64_t ticks = 0;
+
+        static Timestamp now() noexcept {
+#ifdef LOG_USE_TSC_CLOCK
+            return {TscClock::ticks()};
+#else
+            return {static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now().time_since_epoch()).count())};
+#endif
+        }
+
+        std::chrono::nanoseconds since(Timestamp origin) const noexcept {
+            auto delta = static_cast<std::int64_t>(this->ticks - origin.ticks);
+#ifdef LOG_USE_TSC_CLOCK
+            return TscClock::toDuration(delta);
+#else
+            return std::chrono::nanoseconds{delta};
+#endif
+        }
+
+        Clock::time_point timePoint() const noexcept {
+            return Clock::time_point{std::chrono::duration_cast<Clock::duration>(this->since(Timestamp{}))};
+        }
+    };
+
+    // taken at startup, lines show the seconds elapsed since
+    extern Timestamp g_ref_point;
+
+    // non-owning view over fixed storage, appends are truncated when it is full
+    class FormatBuffer {
+        public:
+            FormatBuffer(char* data, std::size_t capacity)
+                : begin{data}, cur{data}, last{data + capacity} {}
+
+            FormatBuffer(FormatBuffer const&) = delete;
+            FormatBuffer& operator=(FormatBuffer const&) = delete;
+
+            void append(char c) {
+                if (this->cur != this->last)
+                    *this->cur++ = c;
+                else
+                    this->cut = true;
+            }
+
+            void append(char const* s, std::size_t n) {
+                auto room = static_cast<std::size_t>(this->last - this->cur);
+                if (n > room) {
+                    n = room;
+                    this->cut = true;
+                }
+                std::memcpy(this->cur, s, n);
+                this->cur += n;
+            }
+
+            void append(std::string_view s) { this->append(s.data(), s.size()); }
+
+            // appends c even when full, replacing the last character (line terminators)
+            void terminate(char c) {
+                if (this->cur == this->last && this->cur != this->begin) {
+                    this->cur--;
+                    this->cut = true;
+                }
+                this->append(c);
+            }
+
+            // direct access for std::to_chars & co
+            char* cursor() { return this->cur; }
+            char* end() { return this->last; }
+            void advance(char* p) { this->cur = p; }
+            void truncate() { this->cut = true; }
+
+            char const* data() const { return this->begin; }
+            std::size_t size() const { return static_cast<std::size_t>(this->cur - this->begin); }
+            void clear() {
+                this->cur = this->begin;
+                this->cut = false;
+            }
+
+            // something didn't fit and was dropped since the last clear()
+            bool truncated() const { return this->cut; }
+
+        private:
+            char* begin;
+            char* cur;
+            char* last;
+            bool cut = false;
+    };
+
+    template <std::size_t N> class FixedFormatBuffer : public FormatBuffer {
+        public:
+            FixedFormatBuffer() : FormatBuffer{storage, N} {}
+
+        private:
+            char storage[N];
+    };
+
+    // per-thread line used by the synchronous front end
+    FormatBuffer& threadLineBuffer();
+
+    // streambuf over a FormatBuffer, lets operator<< types format without allocating
+    class FormatStreamBuf : public std::streambuf {
+        public:
+            void reset(FormatBuffer& out) { this->out = &out; }
+
+        protected:
+            int_type overflow(int_type ch) override {
+                if (!traits_type::eq_int_type(ch, traits_type::eof()))
+                    this->out->append(traits_type::to_char_type(ch));
+                return traits_type::not_eof(ch);
+            }
+
+            std::streamsize xsputn(char const* s, std::streamsize n) override {
+                this->out->append(s, static_cast<std::size_t>(n));
+                return n;
+            }
+
+        private:
+            FormatBuffer* out = nullptr;
+    };
+
+    // Customization point: specialize for a user type to bypass iostreams,
+    //
+    //     template <> struct log::Formatter<Point> {
+    //         static void format(log::FormatBuffer& out, Point const& p) { ... }
+    //     };
+    //
+    // Formatter calls in progress on the thread that went through an ostream
+    inline thread_local int t_streamDepth = 0;
+
+    // anything else with an operator<< goes through a reused thread-local
+    // ostream whose state is reset for every value. An operator<< that
+    // formats again (log::join, another Formatter) gets a local stream: the
+    // outer one is still writing.
+    template <typename T, typename Enable = void> struct Formatter {
+        static void format(FormatBuffer& out, T const& value) {
+            thread_local FormatStreamBuf buf;
+            thread_local std::ostream stream{&buf};
+            if (t_streamDepth > 0) {
+                auto nestedBuf = FormatStreamBuf{};
+                auto nested = std::ostream{&nestedBuf};
+                nestedBuf.reset(out);
+                nested << value;
+                return;
+            }
+
+            auto depth = StreamDepth{};
+            buf.reset(out);
+            stream.flags(std::ios_base::dec | std::ios_base::skipws);
+            stream.precision(6);
+            stream.width(0);
+            stream.clear();
+            stream << value;
+        }
+
+        private:
+            // also counts down when operator<< throws
+            struct StreamDepth {
+                StreamDepth() { t_streamDepth++; }
+                ~StreamDepth() { t_streamDepth--; }
+            };
+    };
+
+    template <> struct Formatter<bool> {
+        static void format(FormatBuffer& out, bool value) { out.append(value ? '1' : '0'); }
+    };
+
+    template <> struct Formatter<char> {
+        static void format(FormatBuffer& out, char value) { out.append(value); }
+    };
+
+    template <> struct Formatter<signed char> {
+        static void format(FormatBuffer& out, signed char value) { out.append(static_cast<char>(value)); }
+    };
+
+    template <> struct Formatter<unsigned char> {
+        static void format(FormatBuffer& out, unsigned char value) { out.append(static_cast<char>(value)); }
+    };
+
+    template <typename T>
+        struct Formatter<T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool> &&
+            !std::is_same_v<T, char> && !std::is_same_v<T, signed char> && !std::is_same_v<T, unsigned char>>> {
+            static void format(FormatBuffer& out, T value) {
+                auto result = std::to_chars(out.cursor(), out.end(), value);
+                if (result.ec == std::errc{})
+                    out.advance(result.ptr);
+                else
+                    out.truncate();
+            }
+        };
+
+    // shortest representation that reads back to the same value
+    template <typename T> struct Formatter<T, std::enable_if_t<std::is_floating_point_v<T>>> {
+        static void format(FormatBuffer& out, T value) {
+            auto result = std::to_chars(out.cursor(), out.end(), value);
+            if (result.ec == std::errc{})
+                out.advance(result.ptr);
+            else
+                out.truncate();
+        }
+    };
+
+    template <> struct Formatter<char const*> {
+        static void format(FormatBuffer& out, char const* value) {
+            if (value != nullptr)
+                out.append(value, std::strlen(value));
+        }
+    };
+
+    template <> struct Formatter<char*> : Formatter<char const*> {};
+
+    template <> struct Formatter<std::string> {
+        static void format(FormatBuffer& out, std::string const& value) { out.append(value); }
+    };
+
+    template <> struct Formatter<std::string_view> {
+        static void format(FormatBuffer& out, std::string_view value) { out.append(value); }
+    };
+
+    // "[seconds.xxxx]" relative to g_ref_point
+    template <> struct Formatter<Timestamp> {
+        static void format(FormatBuffer& out, Timestamp t) {
+            formatElapsed(out, t.since(g_ref_point).count());
+        }
+
+        static void formatElapsed(FormatBuffer& out, std::int64_t ns) {
+            auto negative = ns < 0;
+            auto units = ((negative ? -ns : ns) + 50000) / 100000; // 1/10000 s
+            char frac[4] = {'0', '0', '0', '0'};
+            for (int i = 3; i >= 0; i--, units /= 10)
+                frac[i] = static_cast<char>('0' + units % 10);
+
+            out.append('[');
+            if (negative)
+                out.append('-');
+            Formatter<long long>::format(out, units);
+            out.append('.');
+            out.append(frac, sizeof(frac));
+            out.append(']');
+        }
+    };
+
+    template <> struct Formatter<Clock::time_point> {
+        static void format(FormatBuffer& out, Clock::time_point tp) {
+            Formatter<Timestamp>::formatElapsed(out,
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(tp - g_ref_point.timePoint()).count());
+        }
+    };
+
+    template <typename T> void format(FormatBuffer& out, T const& value) {
+        Formatter<std::decay_t<T>>::format(out, value);
+    }
+
+    template <typename... Ts> FormatBuffer& join(FormatBuffer& out, char const* sep, Ts const&... as) {
+        auto n = sizeof...(as);
+        auto sepSize = std::strlen(sep);
+        ((format(out, as), --n == 0 ? void() : out.append(sep, sepSize)), ...);
+        return out;
+    }
+}
+
+#endif //__LOGGER_FORMAT_H__
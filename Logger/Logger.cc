@@ -1,5 +1,36 @@
 #include "Logger.h"
 
+#include <atomic>
+
 namespace log {
-    std::chrono::steady_clock::time_point g_ref_point = std::chrono::steady_clock::now();
+    Timestamp g_ref_point = Timestamp::now();
+
+    std::atomic<Level> g_level{Level::INFO};
+
+    FormatBuffer& threadLineBuffer() {
+        thread_local FixedFormatBuffer<4096> line;
+        return line;
+    }
+
+    namespace {
+        class ClogSink : public Sink {
+            public:
+                void write(char const* data, std::size_t size) override {
+                    std::clog.write(data, static_cast<std::streamsize>(size));
+                }
+
+                void flush() override { std::clog.flush(); }
+        };
+
+        ClogSink g_clog_sink;
+        std::atomic<Sink*> g_sink{&g_clog_sink};
+    }
+
+    Sink& sink() {
+        return *g_sink.load(std::memory_order_acquire);
+    }
+
+    void setSink(Sink* sink) {
+        g_sink.store(sink != nullptr ? sink : &g_clog_sink, std::memory_order_release);
+    }
 }
@@ -2,17 +2,21 @@
 #define __LOGGER_LOGGER_H__
 
 #include <iostream>
-#include <iomanip>
 #include <chrono>
 #include <cerrno>
 #include <cstring>
+#include <string>
 
-namespace log {
-    extern std::chrono::steady_clock::time_point g_ref_point;
+#include "Filter.h"
+#include "Format.h"
+#include "Sink.h"
+#include "AsyncLogger.h"
 
-    inline std::ostream& operator<<(std::ostream& out, std::chrono::steady_clock::time_point const& tp) {
-        auto elapsed = std::chrono::duration<double>(tp - g_ref_point);
-        return out << "[" << std::fixed << std::setprecision(4) << elapsed.count() << "]";
+namespace log {
+    inline std::ostream& operator<<(std::ostream& out, Clock::time_point const& tp) {
+        auto buffer = FixedFormatBuffer<32>{};
+        format(buffer, tp);
+        return out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
     }
 
     template <typename... Ts>
@@ -23,24 +27,88 @@ namespace log {
             return str;
         }
 
+    // unbounded, and with its own storage: it may run while a log line is being
+    // formatted into threadLineBuffer(), e.g. from an operator<<
     template <typename... Ts> std::string join(char const* sep, Ts&&... as) {
-        return join(std::stringstream{}, sep, std::forward<Ts>(as)...).str();
+        auto text = std::string(256, '\0');
+        while (true) {
+            auto out = FormatBuffer{&text[0], text.size()};
+            join(out, sep, as...);
+            if (!out.truncated()) {
+                text.resize(out.size());
+                return text;
+            }
+            // format again with twice the room
+            text.resize(text.size() * 2);
+        }
     }
 
+    namespace detail {
+        inline void appendSuppressed(FormatBuffer& out, std::uint64_t suppressed) {
+            if (suppressed == 0)
+                return;
+            out.append(" [suppressed: ", 14);
+            format(out, suppressed);
+            out.append(']');
+        }
+
+        // the async backend when it's on, sink() otherwise
+        template <typename... Ts>
+            void emitAt(char level, Timestamp now, int error, std::uint64_t suppressed, Ts const&... as) {
+            auto submitted = async::submit(level, now, error, [&](FormatBuffer& out) {
+                join(out, " ", as...);
+                appendSuppressed(out, suppressed);
+            });
+            if (submitted)
+                return;
+
+            auto& line = threadLineBuffer();
+            line.clear();
+            format(line, now);
+            line.append(' ');
+            line.append(level);
+            line.append(": ", 2);
+            join(line, " ", as...);
+            appendSuppressed(line, suppressed);
+            if (level == 'E') {
+                line.append(" [errno: ", 9);
+                format(line, error);
+                line.append(" - ", 3);
+                format(line, std::strerror(error));
+                line.append(']');
+            }
+            line.terminate('\n');
+
+            auto& out = sink();
+            out.write(line.data(), line.size());
+            out.flush();
+        }
+
+        template <typename... Ts> void emit(char level, int error, std::uint64_t suppressed, Ts const&... as) {
+            emitAt(level, Timestamp::now(), error, suppressed, as...);
+        }
+    }
+
+    // the arguments are always evaluated, use the LOG_* macros of Filter.h on hot paths
     template <typename... Ts> void error(Ts&&... as) {
-        auto now = std::chrono::steady_clock::now();
-        join(std::clog, " ", now, "E:", std::forward<Ts>(as)...)
-            << " [errno: " << errno << " - " << std::strerror(errno) << "]" << std::endl;
+        if constexpr (isCompiledIn(Level::ERROR)) {
+            if (isEnabled(Level::ERROR))
+                detail::emit('E', errno, 0, as...);
+        }
     }
 
     template <typename... Ts> void warn(Ts&&... as) {
-        auto now = std::chrono::steady_clock::now();
-        join(std::clog, " ", now, "W:", std::forward<Ts>(as)...) << std::endl;
+        if constexpr (isCompiledIn(Level::WARN)) {
+            if (isEnabled(Level::WARN))
+                detail::emit('W', 0, 0, as...);
+        }
     }
 
     template <typename... Ts> void info(Ts&&... as) {
-        auto now = std::chrono::steady_clock::now();
-        join(std::clog, " ", now, "I:", std::forward<Ts>(as)...) << std::endl;
+        if constexpr (isCompiledIn(Level::INFO)) {
+            if (isEnabled(Level::INFO))
+                detail::emit('I', 0, 0, as...);
+        }
     }
 
 }
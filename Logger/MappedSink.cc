@@ -0,0 +1,238 @@
+#include "MappedSink.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace log {
+    namespace {
+        std::size_t align8(std::size_t n) {
+            return (n + 7) & ~std::size_t{7};
+        }
+
+        std::uint64_t* cursorOf(char* base) {
+            return reinterpret_cast<std::uint64_t*>(base + MappedSink::CURSOR_OFFSET);
+        }
+
+        // highest sequence among "<prefix>.<sequence>.log" files in directory
+        std::uint64_t lastSequence(std::string const& directory, std::string const& prefix) {
+            auto last = std::uint64_t{0};
+            auto dir = ::opendir(directory.c_str());
+            if (dir == nullptr)
+                return last;
+
+            while (auto entry = ::readdir(dir)) {
+                auto name = std::string{entry->d_name};
+                if (name.size() <= prefix.size() + 5 || name.compare(0, prefix.size() + 1, prefix + ".") != 0 ||
+                        name.compare(name.size() - 4, 4, ".log") != 0)
+                    continue;
+
+                auto digits = name.substr(prefix.size() + 1, name.size() - prefix.size() - 5);
+                if (digits.find_first_not_of("0123456789") != std::string::npos)
+                    continue;
+                auto sequence = std::strtoull(digits.c_str(), nullptr, 10);
+                if (sequence > last)
+                    last = sequence;
+            }
+            ::closedir(dir);
+            return last;
+        }
+
+        // counts a call in progress for as long as it lives
+        class Call {
+            public:
+                explicit Call(std::atomic<int>& calls) : calls{calls} { calls.fetch_add(1); }
+                ~Call() { this->calls.fetch_sub(1); }
+
+            private:
+                std::atomic<int>& calls;
+        };
+    }
+
+    MappedSink::MappedSink(Options options)
+        : options{std::move(options)} {
+            if (this->options.segmentSize < HEADER_SIZE * 2)
+                this->options.segmentSize = HEADER_SIZE * 2;
+            this->rotate(nullptr);
+        }
+
+    MappedSink::~MappedSink() {
+        auto lock = std::lock_guard<std::mutex>{this->mutex};
+        this->current.store(nullptr, std::memory_order_release);
+        for (auto& segment : this->segments) {
+            segment->retired.store(true);
+            if (segment->writers.load() == 0)
+                this->unmap(segment.get());
+        }
+    }
+
+    std::string MappedSink::segmentPath(std::string const& directory, std::string const& prefix,
+            std::uint64_t sequence) {
+        char name[32];
+        std::snprintf(name, sizeof(name), ".%06llu.log", static_cast<unsigned long long>(sequence));
+        return directory + "/" + prefix + name;
+    }
+
+    bool MappedSink::isOpen() const {
+        return this->current.load(std::memory_order_acquire) != nullptr;
+    }
+
+    std::uint64_t MappedSink::dropped() const {
+        return this->droppedCount.load(std::memory_order_relaxed);
+    }
+
+    std::unique_ptr<MappedSink::Segment> MappedSink::openSegment(std::uint64_t sequence) {
+        auto path = segmentPath(this->options.directory, this->options.prefix, sequence);
+        auto size = this->options.segmentSize;
+
+        auto fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd == -1)
+            return nullptr;
+
+        // allocate the blocks now, running out of disk later would be a SIGBUS on memcpy
+        if (::posix_fallocate(fd, 0, static_cast<off_t>(size)) != 0) {
+            ::close(fd);
+            ::unlink(path.c_str());
+            return nullptr;
+        }
+
+        auto base = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (base == MAP_FAILED) {
+            ::close(fd);
+            ::unlink(path.c_str());
+            return nullptr;
+        }
+
+        auto segment = std::make_unique<Segment>();
+        segment->base = static_cast<char*>(base);
+        segment->size = size;
+        segment->sequence = sequence;
+        segment->fd = fd;
+
+        auto segmentSize = static_cast<std::uint64_t>(size);
+        auto cursor = static_cast<std::uint64_t>(HEADER_SIZE);
+        std::memcpy(segment->base, MAGIC, sizeof(MAGIC));
+        std::memcpy(segment->base + SEQUENCE_OFFSET, &sequence, sizeof(sequence));
+        std::memcpy(segment->base + SIZE_OFFSET, &segmentSize, sizeof(segmentSize));
+        __atomic_store_n(cursorOf(segment->base), cursor, __ATOMIC_RELEASE);
+
+        if (this->options.maxSegments > 0 && sequence > this->options.maxSegments)
+            ::unlink(segmentPath(this->options.directory, this->options.prefix,
+                        sequence - this->options.maxSegments).c_str());
+
+        return segment;
+    }
+
+    void MappedSink::write(char const* data, std::size_t size) {
+        auto capacity = this->options.segmentSize - HEADER_SIZE - RECORD_HEADER_SIZE;
+        if (size > capacity)
+            size = capacity;
+        auto total = align8(RECORD_HEADER_SIZE + size);
+
+        auto call = Call{this->calls};
+        while (true) {
+            auto segment = this->current.load(std::memory_order_seq_cst);
+            if (segment == nullptr) {
+                // the first segment couldn't be opened, try again
+                if (this->rotate(nullptr))
+                    continue;
+                this->droppedCount.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            // pins the mapping, rotate() only unmaps a retired segment without writers
+            segment->writers.fetch_add(1);
+            if (segment->retired.load()) {
+                this->release(segment);
+                continue;
+            }
+
+            auto offset = __atomic_fetch_add(cursorOf(segment->base), total, __ATOMIC_RELAXED);
+            if (offset + total <= segment->size) {
+                auto record = segment->base + offset;
+                auto length = static_cast<std::uint32_t>(size);
+                std::memcpy(record + 4, &length, sizeof(length));
+                std::memcpy(record + RECORD_HEADER_SIZE, data, size);
+                __atomic_store_n(reinterpret_cast<std::uint32_t*>(record), RECORD_MARKER, __ATOMIC_RELEASE);
+                this->release(segment);
+                return;
+            }
+
+            this->release(segment);
+            // the segment stays current when the next can't be opened: this line
+            // is dropped, the next write tries again
+            if (!this->rotate(segment)) {
+                this->droppedCount.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+    }
+
+    void MappedSink::sync() {
+        auto call = Call{this->calls};
+        auto segment = this->current.load(std::memory_order_seq_cst);
+        if (segment == nullptr)
+            return;
+
+        segment->writers.fetch_add(1);
+        if (!segment->retired.load())
+            ::msync(segment->base, segment->size, MS_ASYNC);
+        this->release(segment);
+    }
+
+    bool MappedSink::rotate(Segment* full) {
+        auto lock = std::lock_guard<std::mutex>{this->mutex};
+        if (this->current.load(std::memory_order_relaxed) != full)
+            return true;
+
+        // never reuse a segment left by a previous run, it may hold the tail of a crash
+        auto sequence = full != nullptr ? full->sequence + 1 :
+            lastSequence(this->options.directory, this->options.prefix) + 1;
+        auto next = this->openSegment(sequence);
+        if (next == nullptr)
+            return false;
+        this->current.store(next.get(), std::memory_order_seq_cst);
+        this->segments.push_back(std::move(next));
+        if (full == nullptr)
+            return true;
+
+        full->retired.store(true);
+        if (full->writers.load() == 0)
+            this->unmap(full);
+
+        // a call that read `current` before the store above may still hold an
+        // older segment: they're only freed when this is the one call left
+        if (this->calls.load(std::memory_order_seq_cst) <= 1) {
+            this->segments.erase(std::remove_if(this->segments.begin(), this->segments.end(),
+                        [](auto const& segment) { return segment->unmapped.load(); }),
+                    this->segments.end());
+        }
+        return true;
+    }
+
+    void MappedSink::release(Segment* segment) {
+        if (segment->writers.fetch_sub(1) == 1 && segment->retired.load())
+            this->unmap(segment);
+    }
+
+    void MappedSink::unmap(Segment* segment) {
+        if (segment->unmapped.exchange(true))
+            return;
+
+        // shrink the file to what was actually used
+        auto used = __atomic_load_n(cursorOf(segment->base), __ATOMIC_ACQUIRE);
+        if (used > segment->size)
+            used = segment->size;
+        ::munmap(segment->base, segment->size);
+        if (::ftruncate(segment->fd, static_cast<off_t>(used)) == -1) {
+            // the segment keeps its preallocated size, readers stop at the cursor anyway
+        }
+        ::close(segment->fd);
+        segment->base = nullptr;
+    }
+}
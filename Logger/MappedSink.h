@@ -0,0 +1,90 @@
+#ifndef __LOGGER_MAPPED_SINK_H__
+#define __LOGGER_MAPPED_SINK_H__
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "Sink.h"
+
+namespace log {
+    // Appends lines to pre-sized, memory-mapped segment files. Writers reserve
+    // space with an atomic cursor kept in the segment header and memcpy the
+    // line, a record becomes visible once its marker is stored. Pages belong
+    // to the kernel as soon as they are written so a crash of the process
+    // loses nothing that was written; logrecover reads the segments back.
+    //
+    //     auto sink = log::MappedSink{{"/var/log/app", "app"}};
+    //     log::setSink(&sink);
+    class MappedSink : public Sink {
+        public:
+            struct Options {
+                std::string directory = ".";
+                std::string prefix = "log";
+                std::size_t segmentSize = 64 * 1024 * 1024;
+                std::size_t maxSegments = 0; // oldest segments are deleted beyond this, 0 keeps all
+            };
+
+            // segment file layout, integers in host byte order:
+            //   header  "LOGSEG01", u64 sequence, u64 size, u64 cursor, padding up to HEADER_SIZE
+            //   record  u32 marker, u32 length, line, padding up to 8 bytes
+            static constexpr char MAGIC[8] = {'L', 'O', 'G', 'S', 'E', 'G', '0', '1'};
+            static constexpr std::size_t HEADER_SIZE = 64;
+            static constexpr std::size_t SEQUENCE_OFFSET = 8;
+            static constexpr std::size_t SIZE_OFFSET = 16;
+            static constexpr std::size_t CURSOR_OFFSET = 24;
+            static constexpr std::uint32_t RECORD_MARKER = 0x52474f4c; // "LOGR"
+            static constexpr std::size_t RECORD_HEADER_SIZE = 8;
+
+            explicit MappedSink(Options options);
+            ~MappedSink() override;
+
+            MappedSink(MappedSink const&) = delete;
+            MappedSink& operator=(MappedSink const&) = delete;
+
+            bool isOpen() const;
+
+            void write(char const* data, std::size_t size) override;
+
+            // lines are in the page cache once written, nothing to do for process crashes
+            void flush() override {}
+
+            // schedules write-back of the current segment (survives host crashes once done)
+            void sync();
+
+            std::uint64_t dropped() const;
+
+            static std::string segmentPath(std::string const& directory, std::string const& prefix,
+                    std::uint64_t sequence);
+
+        private:
+            struct Segment {
+                char* base = nullptr;
+                std::size_t size = 0;
+                std::uint64_t sequence = 0;
+                int fd = -1;
+                std::atomic<int> writers{0};
+                std::atomic<bool> retired{false};
+                std::atomic<bool> unmapped{false};
+            };
+
+            std::unique_ptr<Segment> openSegment(std::uint64_t sequence);
+            // false when no segment could be opened, `full` (nullptr: none yet) stays current
+            bool rotate(Segment* full);
+            void release(Segment* segment);
+            void unmap(Segment* segment);
+
+            Options options;
+            std::atomic<Segment*> current{nullptr};
+            std::atomic<std::uint64_t> droppedCount{0};
+            std::atomic<int> calls{0}; // write() and sync() in progress, see rotate()
+
+            std::mutex mutex;
+            std::deque<std::unique_ptr<Segment>> segments; // current and those still mapped
+    };
+}
+
+#endif //__LOGGER_MAPPED_SINK_H__
@@ -0,0 +1,24 @@
+#ifndef __LOGGER_SINK_H__
+#define __LOGGER_SINK_H__
+
+#include <cstddef>
+
+namespace log {
+    // destination of formatted lines, every write() holds whole lines
+    class Sink {
+        public:
+            virtual ~Sink() = default;
+
+            virtual void write(char const* data, std::size_t size) = 0;
+            virtual void flush() {}
+    };
+
+    // std::clog unless setSink() installed something else
+    Sink& sink();
+
+    // the sink must outlive every log call made while it is installed,
+    // nullptr restores std::clog
+    void setSink(Sink* sink);
+}
+
+#endif //__LOGGER_SINK_H__
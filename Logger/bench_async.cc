@@ -0,0 +1,75 @@
+#include <algorithm>
+#include <iomanip>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#include "Logger.h"
+
+// compares the synchronous std::clog path with the async backend,
+// log output goes to /dev/null so only the logging cost is measured
+namespace {
+    struct Result {
+        double nsPerCall;
+        double p99Ns;
+        double linesPerSec;
+    };
+
+    Result run(unsigned threads, int linesPerThread, bool async) {
+        auto latencies = std::vector<std::vector<std::int64_t>>(threads);
+        auto workers = std::vector<std::thread>{};
+
+        if (async)
+            log::async::start({});
+
+        auto begin = std::chrono::steady_clock::now();
+        for (unsigned t = 0; t < threads; t++) {
+            workers.emplace_back([&, t] {
+                auto& samples = latencies[t];
+                samples.reserve(linesPerThread);
+                for (int i = 0; i < linesPerThread; i++) {
+                    auto start = std::chrono::steady_clock::now();
+                    log::info("thread", t, "iteration", i, "value", 3.14);
+                    samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                std::chrono::steady_clock::now() - start).count());
+                }
+            });
+        }
+        for (auto& w : workers)
+            w.join();
+        if (async)
+            log::async::stop();
+        auto wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin);
+
+        auto all = std::vector<std::int64_t>{};
+        for (auto& samples : latencies)
+            all.insert(all.end(), samples.begin(), samples.end());
+        std::sort(all.begin(), all.end());
+
+        auto sum = 0.0;
+        for (auto ns : all)
+            sum += ns;
+
+        return {sum / all.size(), static_cast<double>(all[all.size() * 99 / 100]),
+            all.size() / wall.count()};
+    }
+}
+
+int main() {
+    auto devnull = std::ofstream{"/dev/null"};
+    auto saved = std::clog.rdbuf(devnull.rdbuf());
+
+    std::cout << "threads   mode   ns/call   p99 ns   lines/s\n";
+    for (unsigned threads : {1u, 2u, 4u, 8u, 16u, 32u}) {
+        auto lines = 200000 / static_cast<int>(threads);
+        for (bool async : {false, true}) {
+            auto r = run(threads, lines, async);
+            std::cout << std::setw(7) << threads << std::setw(7) << (async ? "async" : "sync")
+                << std::setw(10) << std::setprecision(1) << std::fixed << r.nsPerCall
+                << std::setw(9) << r.p99Ns
+                << std::setw(10) << std::setprecision(0) << r.linesPerSec << "\n";
+        }
+    }
+
+    std::clog.rdbuf(saved);
+}
@@ -0,0 +1,76 @@
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+#include <sstream>
+
+#include "Logger.h"
+
+// ns and heap allocations per formatted line, the stringstream path is the
+// join() log::info used before Format.h
+namespace {
+    std::atomic<std::size_t> g_allocations{0};
+
+    struct LegacyTimestamp {
+        log::Clock::time_point tp;
+    };
+
+    std::ostream& operator<<(std::ostream& out, LegacyTimestamp const& t) {
+        auto elapsed = std::chrono::duration<double>(t.tp - log::g_ref_point.timePoint());
+        return out << "[" << std::fixed << std::setprecision(4) << elapsed.count() << "]";
+    }
+
+    template <typename... Ts> std::string legacyJoin(char const* sep, Ts&&... as) {
+        auto str = std::stringstream{};
+        auto n = sizeof...(as);
+        (void)std::initializer_list<int>{
+            (str << std::forward<Ts>(as) << (--n == 0 ? "" : sep), 0)...};
+        return str.str();
+    }
+
+    template <typename F> void measure(char const* name, F&& f) {
+        constexpr int ITERATIONS = 1000000;
+        for (int i = 0; i < 1000; i++)
+            f(i);
+
+        auto allocations = g_allocations.load();
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < ITERATIONS; i++)
+            f(i);
+        auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start);
+        allocations = g_allocations.load() - allocations;
+
+        std::cout << std::setw(12) << name << std::setw(12) << std::fixed << std::setprecision(1)
+            << elapsed.count() / ITERATIONS << " ns" << std::setw(10) << std::setprecision(2)
+            << static_cast<double>(allocations) / ITERATIONS << " allocs\n";
+    }
+}
+
+void* operator new(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (auto p = std::malloc(size))
+        return p;
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+int main() {
+    auto sink = std::size_t{0};
+    auto now = log::Timestamp::now().timePoint();
+
+    std::cout << "        path     ns/call   allocs/call\n";
+    measure("stringstream", [&](int i) {
+        auto line = legacyJoin(" ", LegacyTimestamp{now}, "I:", "iteration", i, "value", 3.14 * i, "flag", i % 2 == 0);
+        sink += line.size();
+    });
+    measure("format", [&](int i) {
+        auto& line = log::threadLineBuffer();
+        line.clear();
+        log::join(line, " ", now, "I:", "iteration", i, "value", 3.14 * i, "flag", i % 2 == 0);
+        sink += line.size();
+    });
+
+    return sink == 0;
+}
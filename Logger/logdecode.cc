@@ -0,0 +1,64 @@
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "BinaryLogger.h"
+
+// usage: logdecode <file>
+// prints the records of a LOG_BIN_* stream as the text log::info & co would
+// have produced, records of each thread come in the order they were flushed
+int main(int argc, char const* argv[]) {
+    if (argc != 2) {
+        std::cerr << "usage: " << argv[0] << " <binary log>\n";
+        return 2;
+    }
+
+    auto file = std::fopen(argv[1], "rb");
+    if (file == nullptr) {
+        std::cerr << "cannot open " << argv[1] << ": " << std::strerror(errno) << "\n";
+        return 1;
+    }
+
+    char magic[sizeof(log::binary::MAGIC)];
+    if (std::fread(magic, 1, sizeof(magic), file) != sizeof(magic) ||
+            std::memcmp(magic, log::binary::MAGIC, sizeof(magic)) != 0) {
+        std::cerr << argv[1] << " is not a binary log\n";
+        std::fclose(file);
+        return 1;
+    }
+
+    auto decoder = log::binary::Decoder{};
+    auto data = std::vector<char>(1 << 20);
+    auto text = std::string{};
+    auto pending = std::size_t{0};
+
+    while (true) {
+        auto n = std::fread(data.data() + pending, 1, data.size() - pending, file);
+        pending += n;
+
+        auto offset = std::size_t{0};
+        while (offset < pending) {
+            auto consumed = decoder.decode(data.data() + offset, pending - offset, text);
+            if (consumed == 0)
+                break;
+            offset += consumed;
+        }
+        std::cout << text;
+        text.clear();
+
+        std::memmove(data.data(), data.data() + offset, pending - offset);
+        pending -= offset;
+
+        if (n == 0)
+            break;
+        if (pending == data.size())
+            data.resize(data.size() * 2);
+    }
+    std::fclose(file);
+
+    if (pending != 0) {
+        std::cerr << pending << " trailing bytes could not be decoded\n";
+        return 1;
+    }
+}
@@ -0,0 +1,116 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "MappedSink.h"
+
+// usage: logrecover <segment>...
+// prints every committed line of MappedSink segments in sequence order, including
+// the segment that was being written when the process died; bytes that belong to
+// records which were reserved but never committed are skipped and reported
+namespace {
+    struct Segment {
+        std::string path;
+        std::uint64_t sequence;
+    };
+
+    bool readSequence(std::string const& path, std::uint64_t& sequence) {
+        char header[log::MappedSink::HEADER_SIZE];
+        auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1)
+            return false;
+        auto n = ::read(fd, header, sizeof(header));
+        ::close(fd);
+        if (n != static_cast<ssize_t>(sizeof(header)) ||
+                std::memcmp(header, log::MappedSink::MAGIC, sizeof(log::MappedSink::MAGIC)) != 0)
+            return false;
+        std::memcpy(&sequence, header + log::MappedSink::SEQUENCE_OFFSET, sizeof(sequence));
+        return true;
+    }
+
+    // returns the number of bytes skipped
+    std::size_t recover(std::string const& path, std::size_t& records) {
+        auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat st = {};
+        if (fd == -1 || ::fstat(fd, &st) == -1) {
+            std::cerr << "cannot open " << path << ": " << std::strerror(errno) << "\n";
+            if (fd != -1)
+                ::close(fd);
+            return 0;
+        }
+
+        auto fileSize = static_cast<std::size_t>(st.st_size);
+        auto base = static_cast<char const*>(::mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, fd, 0));
+        ::close(fd);
+        if (base == MAP_FAILED)
+            return 0;
+
+        auto cursor = std::uint64_t{0};
+        std::memcpy(&cursor, base + log::MappedSink::CURSOR_OFFSET, sizeof(cursor));
+        auto end = std::min<std::size_t>(fileSize, cursor);
+
+        auto skipped = std::size_t{0};
+        auto gap = std::size_t{0}; // only a hole if a committed record follows it
+        auto offset = log::MappedSink::HEADER_SIZE;
+        while (offset + log::MappedSink::RECORD_HEADER_SIZE <= end) {
+            auto marker = std::uint32_t{0};
+            auto length = std::uint32_t{0};
+            std::memcpy(&marker, base + offset, sizeof(marker));
+            std::memcpy(&length, base + offset + 4, sizeof(length));
+
+            auto payload = offset + log::MappedSink::RECORD_HEADER_SIZE;
+            if (marker != log::MappedSink::RECORD_MARKER || length > end - payload) {
+                // uncommitted reservation, resynchronize on the next 8-byte boundary
+                offset += 8;
+                gap += 8;
+                continue;
+            }
+
+            skipped += gap;
+            gap = 0;
+            std::cout.write(base + payload, length);
+            records++;
+            offset = (payload + length + 7) & ~std::size_t{7};
+        }
+
+        ::munmap(const_cast<char*>(base), fileSize);
+        return skipped;
+    }
+}
+
+int main(int argc, char const* argv[]) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <segment>...\n";
+        return 2;
+    }
+
+    auto segments = std::vector<Segment>{};
+    for (int i = 1; i < argc; i++) {
+        auto sequence = std::uint64_t{0};
+        if (readSequence(argv[i], sequence))
+            segments.push_back({argv[i], sequence});
+        else
+            std::cerr << argv[i] << " is not a log segment\n";
+    }
+    std::sort(segments.begin(), segments.end(),
+            [](Segment const& a, Segment const& b) { return a.sequence < b.sequence; });
+
+    auto records = std::size_t{0};
+    auto skipped = std::size_t{0};
+    for (auto const& segment : segments)
+        skipped += recover(segment.path, records);
+
+    std::cerr << records << " records recovered from " << segments.size() << " segments";
+    if (skipped > 0)
+        std::cerr << ", " << skipped << " bytes of incomplete records skipped";
+    std::cerr << "\n";
+}
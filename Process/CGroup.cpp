@@ -0,0 +1,122 @@
+#include "CGroup.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace process {
+    namespace {
+        constexpr auto CPU_PERIOD_US = 100000;
+
+        // how many times remove() looks for killed leftovers to leave the leaf
+        constexpr auto REMOVE_ATTEMPTS = 100;
+
+        std::atomic<unsigned> created{0};
+
+        bool writeFile(std::string const& path, std::string const& value) {
+            auto fd = ::open(path.c_str(), O_WRONLY | O_CLOEXEC);
+            if (fd == -1)
+                return false;
+            auto written = ::write(fd, value.data(), value.size());
+            auto code = errno;
+            ::close(fd);
+            errno = code;
+            return written == static_cast<ssize_t>(value.size());
+        }
+    }
+
+    CGroup::CGroup(Limits const& limits) {
+        // one controller at a time, the parent may only delegate some of them
+        auto subtree = limits.parent + "/cgroup.subtree_control";
+        if (limits.cpus > 0)
+            writeFile(subtree, "+cpu");
+        if (limits.memoryMax != 0)
+            writeFile(subtree, "+memory");
+        if (limits.pidsMax != 0)
+            writeFile(subtree, "+pids");
+
+        auto path = limits.parent + "/process-" + std::to_string(::getpid()) + "-" + std::to_string(created++);
+        if (::mkdir(path.c_str(), 0755) == -1) {
+            //couldn't create the leaf, errno tells why
+            return;
+        }
+        this->directory = path;
+
+        auto applied = true;
+        if (limits.cpus > 0) {
+            auto quota = static_cast<long>(limits.cpus * CPU_PERIOD_US);
+            applied = this->write("cpu.max", std::to_string(quota < 1000 ? 1000 : quota) + " " + std::to_string(CPU_PERIOD_US));
+        }
+        if (applied && limits.memoryMax != 0)
+            applied = this->write("memory.max", std::to_string(limits.memoryMax));
+        if (applied && limits.pidsMax != 0)
+            applied = this->write("pids.max", std::to_string(limits.pidsMax));
+        if (applied)
+            this->procs = ::open((path + "/cgroup.procs").c_str(), O_WRONLY | O_CLOEXEC);
+
+        if (this->procs == -1) {
+            // a limit the controllers don't support, or one that can't be enforced, isn't ignored
+            auto code = errno;
+            ::rmdir(path.c_str());
+            this->directory.clear();
+            errno = code;
+        }
+    }
+
+    CGroup::~CGroup() {
+        while (!this->remove())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    bool CGroup::remove() {
+        if (this->procs != -1) {
+            ::close(this->procs);
+            this->procs = -1;
+        }
+        if (this->directory.empty())
+            return true;
+
+        // cgroup.kill appeared in Linux 5.14, without it leftovers keep the leaf alive
+        if (this->removeAttempts++ == 0)
+            this->write("cgroup.kill", "1");
+        if (::rmdir(this->directory.c_str()) == -1 && errno == EBUSY && this->removeAttempts <= REMOVE_ATTEMPTS)
+            return false;
+
+        // removed, or something in it survived the kill and the leaf stays
+        this->directory.clear();
+        return true;
+    }
+
+    CGroup::Usage CGroup::usage() const {
+        auto usage = Usage{};
+        if (this->directory.empty())
+            return usage;
+
+        auto stat = std::ifstream{this->directory + "/cpu.stat"};
+        auto key = std::string{};
+        auto value = std::uint64_t{0};
+        while (stat >> key >> value) {
+            if (key == "usage_usec")
+                usage.cpuTime = std::chrono::microseconds(value);
+            else if (key == "user_usec")
+                usage.userTime = std::chrono::microseconds(value);
+            else if (key == "system_usec")
+                usage.systemTime = std::chrono::microseconds(value);
+        }
+
+        // Linux 5.19, and only with the memory controller
+        auto peak = std::ifstream{this->directory + "/memory.peak"};
+        peak >> usage.memoryPeak;
+        return usage;
+    }
+
+    bool CGroup::write(char const* file, std::string const& value) const {
+        return writeFile(this->directory + "/" + file, value);
+    }
+}
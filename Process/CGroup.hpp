@@ -0,0 +1,62 @@
+#ifndef __CGROUP_HPP__
+#define __CGROUP_HPP__
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace process {
+    // A cgroup v2 leaf holding one child and whatever it starts, created under
+    // `Limits::parent`: a delegated subtree (systemd's Delegate=yes, or a
+    // directory of a test hierarchy the process may write to). The limits need
+    // the matching controllers in the parent's cgroup.subtree_control, they're
+    // enabled on the way when the parent allows it. Not thread-safe.
+    class CGroup {
+        public:
+            struct Limits {
+                std::string parent;
+                double cpus = 0;            // cpu.max as a share of one CPU per period, 0: unlimited
+                std::uint64_t memoryMax = 0; // memory.max in bytes, 0: unlimited
+                std::uint64_t pidsMax = 0;   // pids.max, 0: unlimited
+            };
+
+            struct Usage {
+                std::chrono::microseconds cpuTime{0}; // cpu.stat usage_usec
+                std::chrono::microseconds userTime{0};
+                std::chrono::microseconds systemTime{0};
+                std::uint64_t memoryPeak = 0; // memory.peak in bytes, 0 without the memory controller
+            };
+
+            // check valid(): on failure errno tells why and nothing is left behind
+            explicit CGroup(Limits const& limits);
+
+            // kills what's left in the leaf and removes it, waiting up to ~100 ms
+            // for the killed leftovers to leave: see remove() to not wait
+            ~CGroup();
+
+            CGroup(CGroup const&) = delete;
+            CGroup& operator=(CGroup const&) = delete;
+
+            bool valid() const { return this->procs != -1; }
+            std::string const& path() const { return this->directory; }
+
+            // cgroup.procs, open for writing: a process writing "0" to it moves itself in
+            int procsFd() const { return this->procs; }
+
+            Usage usage() const;
+
+            // one attempt at what the destructor does, without sleeping: false
+            // while killed leftovers are still leaving the leaf, call it again
+            // later. True once it's gone, or after enough attempts that it's
+            // given up on.
+            bool remove();
+
+        private:
+            bool write(char const* file, std::string const& value) const;
+
+            std::string directory;
+            int procs = -1;
+            int removeAttempts = 0;
+    };
+}
+#endif // __CGROUP_HPP__
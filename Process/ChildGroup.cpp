@@ -0,0 +1,204 @@
+#include "ChildGroup.hpp"
+#include "Reaper.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace process {
+    namespace {
+        // how often members without a pidfd are polled, in ms
+        constexpr auto POLL_MS = 1;
+
+        auto const FOREVER = std::chrono::steady_clock::time_point::max();
+
+        std::chrono::steady_clock::time_point deadlineIn(std::chrono::nanoseconds const& timeout) {
+            return std::chrono::steady_clock::now()
+                + std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout);
+        }
+    }
+
+    ChildGroup::ChildGroup()
+        : epollFd{::epoll_create1(EPOLL_CLOEXEC)} {}
+
+    ChildGroup::~ChildGroup() {
+        if (this->live != 0)
+            this->terminate();
+        if (this->epollFd != -1)
+            ::close(this->epollFd);
+    }
+
+    std::size_t ChildGroup::launch(CommandLine const& commandLine,
+            std::string const& workingDirectory,
+            bool silenceOutput) {
+        auto pid = process::launch(commandLine, workingDirectory, silenceOutput, this->group);
+        if (pid == process::NO_CHILD && errno == EPERM && this->group != 0) {
+            // every member was reaped, the group is gone: this one leads a new group
+            this->group = 0;
+            pid = process::launch(commandLine, workingDirectory, silenceOutput, 0);
+        }
+        if (pid == process::NO_CHILD)
+            return NONE;
+        if (this->group == 0)
+            this->group = pid;
+
+        auto index = this->members.size();
+        auto pidfd = this->epollFd != -1 ? pidfdOpen(pid) : -1;
+        if (pidfd != -1) {
+            auto event = epoll_event{};
+            event.events = EPOLLIN;
+            event.data.u64 = index;
+            if (::epoll_ctl(this->epollFd, EPOLL_CTL_ADD, pidfd, &event) == -1) {
+                ::close(pidfd);
+                pidfd = -1;
+            }
+        }
+        if (pidfd == -1)
+            this->unwatched++;
+
+        this->members.push_back(Member{pid, pidfd, Status{}});
+        this->live++;
+        return index;
+    }
+
+    std::vector<std::size_t> ChildGroup::launch(std::vector<CommandLine> const& commandLines,
+            std::string const& workingDirectory,
+            bool silenceOutput) {
+        auto indices = std::vector<std::size_t>{};
+        indices.reserve(commandLines.size());
+        for (auto const& commandLine : commandLines)
+            indices.push_back(this->launch(commandLine, workingDirectory, silenceOutput));
+        return indices;
+    }
+
+    std::size_t ChildGroup::waitAny() {
+        auto finished = this->waitFor(1);
+        return finished.empty() ? NONE : finished.front();
+    }
+
+    std::size_t ChildGroup::waitAny(std::chrono::nanoseconds const& timeout) {
+        auto finished = this->waitFor(1, timeout);
+        return finished.empty() ? NONE : finished.front();
+    }
+
+    std::vector<std::size_t> ChildGroup::waitFor(std::size_t n) {
+        auto finished = std::vector<std::size_t>{};
+        while (finished.size() < n) {
+            if (this->unreported.empty() && (this->live == 0 || !this->poll(FOREVER)))
+                break;
+            while (finished.size() < n && !this->unreported.empty()) {
+                finished.push_back(this->unreported.front());
+                this->unreported.pop_front();
+            }
+        }
+        return finished;
+    }
+
+    std::vector<std::size_t> ChildGroup::waitFor(std::size_t n, std::chrono::nanoseconds const& timeout) {
+        auto deadline = deadlineIn(timeout);
+        auto finished = std::vector<std::size_t>{};
+        while (finished.size() < n) {
+            if (this->unreported.empty() && (this->live == 0 || !this->poll(deadline)))
+                break;
+            while (finished.size() < n && !this->unreported.empty()) {
+                finished.push_back(this->unreported.front());
+                this->unreported.pop_front();
+            }
+        }
+        return finished;
+    }
+
+    bool ChildGroup::waitAll() {
+        while (this->live != 0)
+            this->poll(FOREVER);
+        return true;
+    }
+
+    bool ChildGroup::waitAll(std::chrono::nanoseconds const& timeout) {
+        auto deadline = deadlineIn(timeout);
+        while (this->live != 0) {
+            if (!this->poll(deadline))
+                return false;
+        }
+        return true;
+    }
+
+    void ChildGroup::pause() { this->signal(SIGSTOP); }
+    void ChildGroup::resume() { this->signal(SIGCONT); }
+
+    void ChildGroup::terminate() {
+        this->signal(SIGKILL);
+        this->waitAll();
+    }
+
+    void ChildGroup::signal(int signal) {
+        if (this->group != 0 && this->live != 0)
+            ::kill(-this->group, signal);
+    }
+
+    bool ChildGroup::poll(Deadline deadline) {
+        auto before = this->live;
+        while (true) {
+            if (this->unwatched != 0) {
+                for (std::size_t i = 0; i < this->members.size(); i++) {
+                    auto& member = this->members[i];
+                    if (member.finished || member.pidfd != -1)
+                        continue;
+                    int wstatus = 0;
+                    auto usage = rusage{};
+                    if (::wait4(member.pid, &wstatus, WNOHANG, &usage) == member.pid) {
+                        member.status = Status{wstatus, usage};
+                        member.finished = true;
+                        this->unwatched--;
+                        this->live--;
+                        this->unreported.push_back(i);
+                    }
+                }
+            }
+            if (this->live != before || this->live == 0)
+                return true;
+
+            auto timeout = -1;
+            auto now = std::chrono::steady_clock::now();
+            if (deadline != FOREVER) {
+                if (now >= deadline)
+                    return false;
+                // rounded up, epoll_wait() counts in ms
+                timeout = static_cast<int>(std::chrono::ceil<std::chrono::milliseconds>(deadline - now).count());
+            }
+            if (this->unwatched != 0 || this->epollFd == -1)
+                timeout = timeout == -1 ? POLL_MS : std::min(timeout, POLL_MS);
+
+            epoll_event events[64];
+            auto count = this->epollFd != -1 ? ::epoll_wait(this->epollFd, events, 64, timeout) : 0;
+            if (this->epollFd == -1)
+                ::usleep(static_cast<useconds_t>(timeout) * 1000);
+            for (int i = 0; i < count; i++)
+                this->reap(static_cast<std::size_t>(events[i].data.u64));
+        }
+    }
+
+    void ChildGroup::reap(std::size_t index) {
+        auto& member = this->members[index];
+        if (member.finished)
+            return;
+
+        // the pidfd is readable once the member terminated, this doesn't block
+        int wstatus = 0;
+        auto usage = rusage{};
+        while (::wait4(member.pid, &wstatus, 0, &usage) == -1 && errno == EINTR) {
+        }
+        ::epoll_ctl(this->epollFd, EPOLL_CTL_DEL, member.pidfd, nullptr);
+        ::close(member.pidfd);
+        member.pidfd = -1;
+        member.status = Status{wstatus, usage};
+        member.finished = true;
+        this->live--;
+        this->unreported.push_back(index);
+    }
+}
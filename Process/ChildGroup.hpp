@@ -0,0 +1,93 @@
+#ifndef __CHILD_GROUP_HPP__
+#define __CHILD_GROUP_HPP__
+
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "Process.hpp"
+
+namespace process {
+    // Children started and waited for together. Their pidfds share one epoll
+    // instance that the waiting thread polls itself: waiting for any of 64
+    // children is one epoll_wait(), not 64 futures. All members join the
+    // process group of the first one, so pause/resume/terminate are a single
+    // kill() each. Members are reaped by the group, not the Reaper, and are
+    // addressed by their index. Not thread-safe.
+    class ChildGroup {
+        public:
+            static constexpr auto NONE = static_cast<std::size_t>(-1);
+
+            ChildGroup();
+
+            // members still running are killed and reaped
+            ~ChildGroup();
+
+            ChildGroup(ChildGroup const&) = delete;
+            ChildGroup& operator=(ChildGroup const&) = delete;
+
+            // index of the new member, NONE with errno set when it couldn't start
+            std::size_t launch(CommandLine const& commandLine,
+                    std::string const& workingDirectory = "",
+                    bool silenceOutput = true);
+
+            std::vector<std::size_t> launch(std::vector<CommandLine> const& commandLines,
+                    std::string const& workingDirectory = "",
+                    bool silenceOutput = true);
+
+            std::size_t size() const { return this->members.size(); }
+            std::size_t running() const { return this->live; }
+
+            pid_t pid(std::size_t member) const { return this->members[member].pid; }
+            pid_t processGroup() const { return this->group; }
+
+            // Status{} while the member is running
+            Status const& status(std::size_t member) const { return this->members[member].status; }
+
+            // a member that finished and wasn't returned by waitAny()/waitFor()
+            // yet, NONE when none is left running or on timeout
+            std::size_t waitAny();
+            std::size_t waitAny(std::chrono::nanoseconds const& timeout);
+
+            // the next `n` members to finish, fewer when fewer are running or on timeout
+            std::vector<std::size_t> waitFor(std::size_t n);
+            std::vector<std::size_t> waitFor(std::size_t n, std::chrono::nanoseconds const& timeout);
+
+            // false on timeout, what finished stays available to waitAny()/waitFor()
+            bool waitAll();
+            bool waitAll(std::chrono::nanoseconds const& timeout);
+
+            void pause();
+            void resume();
+
+            // SIGKILL to the process group, then waits for all
+            void terminate();
+
+        private:
+            struct Member {
+                pid_t pid;
+                int pidfd;
+                Status status;
+                bool finished = false;
+            };
+
+            using Deadline = std::chrono::steady_clock::time_point;
+
+            // reaps what exited, waiting until `deadline` for at least one; false on timeout
+            bool poll(Deadline deadline);
+            void reap(std::size_t member);
+            void signal(int signal);
+
+            int epollFd = -1;
+            pid_t group = 0;
+            std::vector<Member> members;
+            std::deque<std::size_t> unreported;
+            std::size_t live = 0;
+            std::size_t unwatched = 0; // members without a pidfd, polled
+    };
+}
+#endif // __CHILD_GROUP_HPP__
@@ -0,0 +1,138 @@
+#include "CommandLine.hpp"
+
+#include <cstring>
+#include <utility>
+
+namespace process {
+    bool splitCommandLine(std::string const& commandLine, std::vector<std::string>& arguments) {
+        auto argument = std::string{};
+        auto started = false; // '' and "" are empty arguments, not nothing
+
+        for (size_t i = 0; i < commandLine.size(); i++) {
+            auto c = commandLine[i];
+
+            if (c == ' ' || c == '\t' || c == '\n') {
+                if (started)
+                    arguments.push_back(std::move(argument));
+                argument.clear();
+                started = false;
+            } else if (c == '\\') {
+                if (++i == commandLine.size())
+                    return false;
+                argument += commandLine[i];
+                started = true;
+            } else if (c == '\'') {
+                auto end = commandLine.find('\'', i + 1);
+                if (end == std::string::npos)
+                    return false;
+                argument.append(commandLine, i + 1, end - i - 1);
+                i = end;
+                started = true;
+            } else if (c == '"') {
+                for (i++; i < commandLine.size() && commandLine[i] != '"'; i++) {
+                    if (commandLine[i] == '\\' && i + 1 < commandLine.size()
+                            && (commandLine[i + 1] == '"' || commandLine[i + 1] == '\\'))
+                        i++;
+                    argument += commandLine[i];
+                }
+                if (i == commandLine.size())
+                    return false;
+                started = true;
+            } else {
+                argument += c;
+                started = true;
+            }
+        }
+
+        if (started)
+            arguments.push_back(std::move(argument));
+        return true;
+    }
+
+    CommandLine::CommandLine(std::string const& commandLine)
+        : commandLine{commandLine} {
+            auto arguments = std::vector<std::string>{};
+            if (splitCommandLine(commandLine, arguments))
+                this->build(arguments, nullptr);
+        }
+
+    CommandLine::CommandLine(std::string const& commandLine, std::vector<std::string> const& environment)
+        : commandLine{commandLine} {
+            auto arguments = std::vector<std::string>{};
+            if (splitCommandLine(commandLine, arguments))
+                this->build(arguments, &environment);
+        }
+
+    CommandLine::CommandLine(std::vector<std::string> const& arguments, std::vector<std::string> const* environment) {
+        for (auto const& argument : arguments)
+            this->commandLine += (this->commandLine.empty() ? "" : " ") + argument;
+        this->build(arguments, environment);
+    }
+
+    CommandLine::CommandLine(CommandLine const& o)
+        : commandLine{o.commandLine} {
+            if (!o.valid())
+                return;
+
+            auto arguments = std::vector<std::string>{o.arguments, o.arguments + o.count};
+            auto environment = std::vector<std::string>{};
+            for (auto e = o.environment; e != nullptr && *e != nullptr; e++)
+                environment.emplace_back(*e);
+            this->build(arguments, o.environment != nullptr ? &environment : nullptr);
+        }
+
+    // the pointers stay valid, they point into the block that moves along
+    CommandLine::CommandLine(CommandLine&& o) noexcept {
+        this->operator=(std::move(o));
+    }
+
+    CommandLine& CommandLine::operator=(CommandLine const& o) {
+        if (this != &o)
+            *this = CommandLine{o};
+        return *this;
+    }
+
+    CommandLine& CommandLine::operator=(CommandLine&& o) noexcept {
+        this->commandLine = std::move(o.commandLine);
+        this->block = std::move(o.block);
+        this->arguments = std::exchange(o.arguments, nullptr);
+        this->environment = std::exchange(o.environment, nullptr);
+        this->count = std::exchange(o.count, 0);
+        return *this;
+    }
+
+    void CommandLine::build(std::vector<std::string> const& arguments, std::vector<std::string> const* environment) {
+        auto pointers = arguments.size() + 1 + (environment != nullptr ? environment->size() + 1 : 0);
+        auto bytes = size_t{0};
+        for (auto const& argument : arguments)
+            bytes += argument.size() + 1;
+        if (environment != nullptr) {
+            for (auto const& variable : *environment)
+                bytes += variable.size() + 1;
+        }
+
+        // the strings live in the same array, after the pointers
+        this->block.reset(new char*[pointers + (bytes + sizeof(char*) - 1) / sizeof(char*)]);
+        auto slot = this->block.get();
+        auto text = reinterpret_cast<char*>(slot + pointers);
+
+        auto copy = [&slot, &text](std::string const& s) {
+            std::memcpy(text, s.c_str(), s.size() + 1);
+            *slot++ = text;
+            text += s.size() + 1;
+        };
+
+        this->arguments = slot;
+        this->count = arguments.size();
+        for (auto const& argument : arguments)
+            copy(argument);
+        *slot++ = nullptr;
+
+        if (environment != nullptr) {
+            this->environment = slot;
+            for (auto const& variable : *environment)
+                copy(variable);
+            *slot++ = nullptr;
+        }
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef __COMMAND_LINE_HPP__
+#define __COMMAND_LINE_HPP__
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace process {
+    // A command line split once, in the parent, into the argv (and optional
+    // envp) arrays exec wants, laid out in a single allocation: the pointer
+    // arrays first, then the NUL-terminated strings they point to. Reusing one
+    // across execute() calls costs no parsing and no allocation for the
+    // arguments, and the forked child only reads it.
+    //
+    // Splitting follows sh: whitespace separates arguments, '...' is literal,
+    // "..." is literal except for \" and \\, a backslash outside quotes escapes
+    // the next character, and quoted parts join the text around them
+    // (--name="a b" is one argument). An unterminated quote or trailing
+    // backslash leaves the command line invalid, execute() then fails with EINVAL.
+    class CommandLine {
+        public:
+            CommandLine() = default;
+
+            CommandLine(std::string const& commandLine);
+
+            // `environment` entries are NAME=value, the child gets exactly these
+            CommandLine(std::string const& commandLine, std::vector<std::string> const& environment);
+
+            // already split, nothing is unquoted
+            CommandLine(std::vector<std::string> const& arguments, std::vector<std::string> const* environment = nullptr);
+
+            CommandLine(CommandLine const& o);
+            CommandLine(CommandLine&& o) noexcept;
+            CommandLine& operator=(CommandLine const& o);
+            CommandLine& operator=(CommandLine&& o) noexcept;
+
+            bool valid() const { return this->arguments != nullptr; }
+
+            // argv()[0] is the program, both arrays are null-terminated
+            char* const* argv() const { return this->arguments; }
+
+            // null when the child inherits the parent's environment
+            char* const* envp() const { return this->environment; }
+
+            std::size_t size() const { return this->count; }
+
+            std::string const& text() const { return this->commandLine; }
+
+        private:
+            void build(std::vector<std::string> const& arguments, std::vector<std::string> const* environment);
+
+            std::string commandLine;
+            std::unique_ptr<char*[]> block;
+            char** arguments = nullptr;
+            char** environment = nullptr;
+            std::size_t count = 0;
+    };
+
+    // splits `commandLine` as described above, false on unbalanced quoting
+    bool splitCommandLine(std::string const& commandLine, std::vector<std::string>& arguments);
+}
+#endif // __COMMAND_LINE_HPP__
@@ -0,0 +1,226 @@
+#include "Deadlines.hpp"
+#include "Reaper.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <iostream>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace process {
+    namespace {
+        // how often exits are polled when they can't be waited for
+        constexpr auto POLL_TICKS = 5;
+
+        // through the Reaper's pidfd: a deadline may expire after the child was
+        // reaped and its pid handed to another process. Children the Reaper
+        // doesn't hold a pidfd for only get the signal while their status isn't in.
+        bool sendSignal(Child& child, int signal, bool group) {
+            if (Reaper::instance().signal(child.pid, signal, group))
+                return true;
+            if (child.isReady())
+                return false;
+            if (group && ::kill(-child.pid, signal) == 0)
+                return true;
+            return ::kill(child.pid, signal) == 0;
+        }
+    }
+
+    Deadlines& Deadlines::instance() {
+        static Deadlines deadlines;
+        return deadlines;
+    }
+
+    Deadlines::Deadlines()
+        : epollFd{::epoll_create1(EPOLL_CLOEXEC)}, wakeFd{::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)},
+        wheel{0} {
+            if (this->epollFd == -1 || this->wakeFd == -1) {
+                std::cerr << "deadlines: couldn't create epoll/eventfd, exits are polled: errno " << errno << "\n";
+            } else {
+                auto event = epoll_event{};
+                event.events = EPOLLIN;
+                event.data.u64 = 0;
+                ::epoll_ctl(this->epollFd, EPOLL_CTL_ADD, this->wakeFd, &event);
+            }
+
+            this->thread = std::thread{[this] { this->run(); }};
+        }
+
+    Deadlines::~Deadlines() {
+        this->stopping.store(true);
+        auto one = std::uint64_t{1};
+        if (this->wakeFd != -1 && ::write(this->wakeFd, &one, sizeof(one)) == sizeof(one))
+            this->thread.join();
+        else
+            this->thread.detach();
+
+        // children still pending are left running
+        for (auto& [id, entry] : this->entries)
+            if (entry.pidfd != -1)
+                ::close(entry.pidfd);
+        if (this->wakeFd != -1)
+            ::close(this->wakeFd);
+        if (this->epollFd != -1)
+            ::close(this->epollFd);
+    }
+
+    void Deadlines::terminate(Child child, std::chrono::milliseconds grace, Callback onDone) {
+        if (!child.futureStatus.valid() || child.isReady()) {
+            onDone(Termination{child.wait(), false});
+            return;
+        }
+
+        auto pidfd = this->epollFd != -1 ? pidfdOpen(child.pid) : -1;
+        sendSignal(child, SIGTERM, false);
+
+        {
+            auto lock = std::lock_guard<std::mutex>{this->mutex};
+            auto id = this->nextId++;
+            this->entries.emplace(id, Entry{std::move(child), pidfd, std::move(onDone)});
+            this->wheel.schedule(this->now() + static_cast<std::uint64_t>(grace.count() < 0 ? 0 : grace.count()), id);
+
+            auto event = epoll_event{};
+            event.events = EPOLLIN;
+            event.data.u64 = id;
+            if (pidfd == -1 || ::epoll_ctl(this->epollFd, EPOLL_CTL_ADD, pidfd, &event) == -1) {
+                if (pidfd != -1)
+                    ::close(pidfd);
+                this->entries.at(id).pidfd = -1;
+                this->waiting.push_back(id);
+            }
+        }
+
+        // the thread may sleep past the new deadline
+        auto one = std::uint64_t{1};
+        if (this->wakeFd != -1 && ::write(this->wakeFd, &one, sizeof(one)) != sizeof(one)) {
+            //couldn't wake the deadline thread, it polls
+        }
+    }
+
+    std::future<Termination> Deadlines::terminate(Child child, std::chrono::milliseconds grace) {
+        auto promise = std::make_shared<std::promise<Termination>>();
+        auto future = promise->get_future();
+        this->terminate(std::move(child), grace, [promise](Termination t) { promise->set_value(t); });
+        return future;
+    }
+
+    std::vector<std::future<Termination>> Deadlines::terminate(std::vector<Child> children,
+            std::chrono::milliseconds grace) {
+        auto futures = std::vector<std::future<Termination>>{};
+        futures.reserve(children.size());
+        for (auto& child : children)
+            futures.push_back(this->terminate(std::move(child), grace));
+        return futures;
+    }
+
+    void Deadlines::retry(std::chrono::milliseconds interval, Attempt attempt) {
+        {
+            auto lock = std::lock_guard<std::mutex>{this->mutex};
+            auto id = this->nextId++;
+            this->retries.emplace(id, Retry{interval, std::move(attempt)});
+            this->wheel.schedule(this->now() + static_cast<std::uint64_t>(interval.count() < 0 ? 0 : interval.count()), id);
+        }
+
+        auto one = std::uint64_t{1};
+        if (this->wakeFd != -1 && ::write(this->wakeFd, &one, sizeof(one)) != sizeof(one)) {
+            //couldn't wake the deadline thread, it polls
+        }
+    }
+
+    std::size_t Deadlines::pending() const {
+        auto lock = std::lock_guard<std::mutex>{this->mutex};
+        return this->entries.size();
+    }
+
+    std::uint64_t Deadlines::now() const {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - this->origin).count());
+    }
+
+    void Deadlines::run() {
+        epoll_event events[64];
+        auto done = std::vector<Entry>{};
+        auto due = std::vector<Retry>{};
+
+        while (!this->stopping.load()) {
+            auto timeout = -1;
+            {
+                auto lock = std::lock_guard<std::mutex>{this->mutex};
+                if (!this->wheel.empty())
+                    timeout = static_cast<int>(this->wheel.idleTicks());
+                if (!this->waiting.empty() || this->epollFd == -1)
+                    timeout = timeout == -1 ? POLL_TICKS : std::min(timeout, POLL_TICKS);
+            }
+
+            auto count = this->epollFd != -1 ? ::epoll_wait(this->epollFd, events, 64, timeout) : 0;
+            if (this->epollFd == -1)
+                std::this_thread::sleep_for(std::chrono::milliseconds{timeout});
+
+            {
+                auto lock = std::lock_guard<std::mutex>{this->mutex};
+                for (int i = 0; i < count; i++) {
+                    auto id = events[i].data.u64;
+                    if (id == 0) {
+                        auto value = std::uint64_t{};
+                        while (::read(this->wakeFd, &value, sizeof(value)) == sizeof(value)) {
+                        }
+                        continue;
+                    }
+
+                    // exited: the Reaper is about to fulfill its status
+                    auto it = this->entries.find(id);
+                    if (it == this->entries.end())
+                        continue;
+                    ::epoll_ctl(this->epollFd, EPOLL_CTL_DEL, it->second.pidfd, nullptr);
+                    ::close(it->second.pidfd);
+                    it->second.pidfd = -1;
+                    it->second.exited = true;
+                    this->waiting.push_back(id);
+                }
+
+                this->wheel.advance(this->now(), [this, &due](std::uint64_t id) {
+                    auto it = this->retries.find(id);
+                    if (it == this->retries.end()) {
+                        this->expire(id);
+                        return;
+                    }
+                    due.push_back(std::move(it->second));
+                    this->retries.erase(it);
+                });
+
+                auto end = std::remove_if(this->waiting.begin(), this->waiting.end(), [this, &done](std::uint64_t id) {
+                    auto it = this->entries.find(id);
+                    if (it == this->entries.end())
+                        return true;
+                    if (!it->second.child.isReady())
+                        return false;
+                    done.push_back(std::move(it->second));
+                    this->entries.erase(it);
+                    return true;
+                });
+                this->waiting.erase(end, this->waiting.end());
+            }
+
+            for (auto& entry : done)
+                entry.onDone(Termination{entry.child.wait(), entry.killed});
+            done.clear();
+
+            // without the lock, an attempt may retry() or terminate()
+            for (auto& retry : due)
+                if (!retry.attempt())
+                    this->retry(retry.interval, std::move(retry.attempt));
+            due.clear();
+        }
+    }
+
+    void Deadlines::expire(std::uint64_t id) {
+        auto it = this->entries.find(id);
+        if (it == this->entries.end() || it->second.exited)
+            return;
+
+        it->second.killed = sendSignal(it->second.child, SIGKILL, true);
+    }
+}
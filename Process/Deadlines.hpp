@@ -0,0 +1,92 @@
+#ifndef __DEADLINES_HPP__
+#define __DEADLINES_HPP__
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Process.hpp"
+#include "TimerWheel.hpp"
+
+namespace process {
+    struct Termination {
+        Status status;
+        bool killed = false; // the grace period ran out, the process group got SIGKILL
+    };
+
+    // Non-blocking "SIGTERM now, SIGKILL the process group if it didn't exit
+    // within the grace period" for any number of children: one thread waits on
+    // the children's pidfds and a hierarchical timer wheel of millisecond ticks,
+    // so shutting down a fleet takes the longest grace period, not their sum.
+    // Without pidfds the exits are polled every few ticks.
+    class Deadlines {
+        public:
+            // called once with the child's final status, from the deadline thread
+            // (or right away when the child was already done)
+            using Callback = std::function<void(Termination)>;
+
+            static Deadlines& instance();
+
+            // takes over `child`
+            void terminate(Child child, std::chrono::milliseconds grace, Callback onDone);
+            std::future<Termination> terminate(Child child, std::chrono::milliseconds grace);
+
+            std::vector<std::future<Termination>> terminate(std::vector<Child> children, std::chrono::milliseconds grace);
+
+            // children between SIGTERM and their outcome
+            std::size_t pending() const;
+
+            // calls `attempt` from the deadline thread every `interval` until it
+            // returns true: for what mustn't wait on the caller's thread, e.g.
+            // removing a cgroup leaf from the Reaper's callback
+            using Attempt = std::function<bool()>;
+            void retry(std::chrono::milliseconds interval, Attempt attempt);
+
+            ~Deadlines();
+
+            Deadlines(Deadlines const&) = delete;
+            Deadlines& operator=(Deadlines const&) = delete;
+
+        private:
+            struct Entry {
+                Child child;
+                int pidfd;
+                Callback onDone;
+                bool killed = false;
+                bool exited = false; // status on its way from the Reaper
+            };
+
+            struct Retry {
+                std::chrono::milliseconds interval;
+                Attempt attempt;
+            };
+
+            Deadlines();
+
+            std::uint64_t now() const;
+            void run();
+            void expire(std::uint64_t id);
+
+            std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+
+            int epollFd = -1;
+            int wakeFd = -1;
+            std::atomic<bool> stopping{false};
+
+            mutable std::mutex mutex;
+            std::unordered_map<std::uint64_t, Entry> entries;
+            std::unordered_map<std::uint64_t, Retry> retries;
+            TimerWheel<std::uint64_t> wheel; // ids of entries and retries, entries may be gone already
+            std::uint64_t nextId = 1;
+            std::vector<std::uint64_t> waiting; // exited, or without a pidfd: polled for their status
+
+            std::thread thread;
+    };
+}
+#endif // __DEADLINES_HPP__
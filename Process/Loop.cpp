@@ -0,0 +1,204 @@
+#include "Loop.hpp"
+#include "Reaper.hpp"
+
+#include <cassert>
+#include <cerrno>
+#include <iostream>
+
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace process {
+    namespace {
+        thread_local Loop* active = nullptr;
+
+        // without reaping it
+        bool hasExited(Child& child) {
+            if (child.futureStatus.valid() && child.isReady())
+                return true;
+            auto info = siginfo_t{};
+            return ::waitid(P_PID, static_cast<id_t>(child.pid), &info, WEXITED | WNOHANG | WNOWAIT) == 0
+                && info.si_pid != 0;
+        }
+    }
+
+    Exited Child::exited() {
+        return Exited{*this, -1};
+    }
+
+    Exited Child::exitedWithin(std::chrono::nanoseconds const& timeout) {
+        auto ms = std::chrono::ceil<std::chrono::milliseconds>(timeout).count();
+        return Exited{*this, ms < 0 ? 0 : static_cast<std::int64_t>(ms)};
+    }
+
+    Child executeUnwatched(CommandLine const& commandLine,
+            std::string const& workingDirectory,
+            bool silenceOutput,
+            bool unblockSignals,
+            Backend backend) {
+        auto pid = launch(commandLine, workingDirectory, silenceOutput, 0, unblockSignals, backend);
+        if (pid == process::NO_CHILD)
+            return Child{};
+        return Child{pid, std::future<Status>{}};
+    }
+
+    bool Exited::await_ready() {
+        if (this->child.pid == process::NO_CHILD)
+            return true;
+        if (this->child.futureStatus.valid() && this->child.isReady()) {
+            this->child.wait();
+            return true;
+        }
+        return this->timeoutMs == 0;
+    }
+
+    void Exited::await_suspend(std::coroutine_handle<> handle) {
+        auto loop = Loop::current();
+        assert(loop != nullptr && "co_await child.exited() outside of Loop::run()");
+        this->waiting = handle;
+        loop->watch(this);
+    }
+
+    void Exited::collect() {
+        if (this->child.futureStatus.valid()) {
+            // the Reaper woke up on the same pidfd, it's about to fulfil the future
+            this->child.wait();
+            return;
+        }
+
+        int wstatus = 0;
+        auto usage = rusage{};
+        while (::wait4(this->child.pid, &wstatus, 0, &usage) == -1 && errno == EINTR) {
+        }
+        this->child.status = Status{wstatus, usage};
+        this->child.pid = process::NO_CHILD;
+    }
+
+    Loop::Loop()
+        : epollFd{::epoll_create1(EPOLL_CLOEXEC)}, wheel{0} {
+            if (this->epollFd == -1)
+                std::cerr << "loop: couldn't create epoll, exits are polled: errno " << errno << "\n";
+        }
+
+    Loop::~Loop() {
+        // coroutines still waiting are dropped with their frames
+        for (auto& handle : this->ready)
+            handle.destroy();
+        if (this->epollFd != -1)
+            ::close(this->epollFd);
+    }
+
+    Loop* Loop::current() {
+        return active;
+    }
+
+    void Loop::spawn(Task task) {
+        auto handle = std::exchange(task.handle, nullptr);
+        handle.promise().loop = this;
+        this->tasks++;
+        this->ready.push_back(handle);
+    }
+
+    std::uint64_t Loop::now() const {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - this->origin).count());
+    }
+
+    void Loop::run() {
+        auto previous = std::exchange(active, this);
+        auto resuming = std::vector<std::coroutine_handle<>>{};
+        while (this->tasks != 0) {
+            while (!this->ready.empty()) {
+                resuming.swap(this->ready);
+                for (auto handle : resuming)
+                    handle.resume();
+                resuming.clear();
+            }
+            if (this->tasks == 0)
+                break;
+            this->poll();
+        }
+        active = previous;
+    }
+
+    void Loop::watch(Exited* exited) {
+        if (exited->timeoutMs > 0) {
+            exited->timer = this->nextTimer++;
+            this->timers.emplace(exited->timer, exited);
+            this->wheel.schedule(this->now() + static_cast<std::uint64_t>(exited->timeoutMs), exited->timer);
+        }
+
+        exited->pidfd = this->epollFd != -1 ? pidfdOpen(exited->child.pid) : -1;
+        auto event = epoll_event{};
+        event.events = EPOLLIN;
+        event.data.ptr = exited;
+        if (exited->pidfd != -1 && ::epoll_ctl(this->epollFd, EPOLL_CTL_ADD, exited->pidfd, &event) == -1) {
+            ::close(exited->pidfd);
+            exited->pidfd = -1;
+        }
+        if (exited->pidfd == -1)
+            this->polled.push_back(exited);
+    }
+
+    void Loop::finish(Exited* exited, bool hasExited) {
+        if (exited->pidfd != -1) {
+            ::epoll_ctl(this->epollFd, EPOLL_CTL_DEL, exited->pidfd, nullptr);
+            ::close(exited->pidfd);
+            exited->pidfd = -1;
+        }
+        if (exited->timer != 0) {
+            this->timers.erase(exited->timer);
+            exited->timer = 0;
+        }
+        if (hasExited)
+            exited->collect();
+        this->ready.push_back(exited->waiting);
+    }
+
+    void Loop::poll() {
+        // until the next slot of the wheel holding timers only an exit can wake us up
+        auto timeout = -1;
+        if (!this->wheel.empty())
+            timeout = static_cast<int>(this->wheel.idleTicks());
+        if (!this->polled.empty())
+            timeout = 1;
+
+        epoll_event events[256];
+        auto count = this->epollFd != -1 ? ::epoll_wait(this->epollFd, events, 256, timeout) : 0;
+        if (this->epollFd == -1 && timeout > 0)
+            ::usleep(static_cast<useconds_t>(timeout) * 1000);
+        for (int i = 0; i < count; i++)
+            this->finish(static_cast<Exited*>(events[i].data.ptr), true);
+
+        for (std::size_t i = 0; i < this->polled.size();) {
+            auto exited = this->polled[i];
+            if (hasExited(exited->child)) {
+                this->polled[i] = this->polled.back();
+                this->polled.pop_back();
+                this->finish(exited, true);
+            } else {
+                i++;
+            }
+        }
+
+        this->wheel.advance(this->now(), [this](std::uint64_t id) {
+            auto timer = this->timers.find(id);
+            if (timer == this->timers.end())
+                return;
+            auto exited = timer->second;
+            if (exited->pidfd == -1) {
+                for (auto& entry : this->polled) {
+                    if (entry == exited) {
+                        entry = this->polled.back();
+                        this->polled.pop_back();
+                        break;
+                    }
+                }
+            }
+            // its exit may be among the events not returned yet
+            this->finish(exited, hasExited(exited->child));
+        });
+    }
+}
@@ -0,0 +1,142 @@
+#ifndef __LOOP_HPP__
+#define __LOOP_HPP__
+
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Process.hpp"
+#include "TimerWheel.hpp"
+
+// C++20: coroutines awaiting children on a single-threaded event loop.
+namespace process {
+    class Loop;
+
+    // a coroutine given to Loop::spawn(), its frame is freed when it returns
+    class Task {
+        public:
+            struct promise_type {
+                Loop* loop = nullptr;
+
+                ~promise_type();
+
+                Task get_return_object() {
+                    return Task{std::coroutine_handle<promise_type>::from_promise(*this)};
+                }
+                std::suspend_always initial_suspend() noexcept { return {}; }
+                std::suspend_never final_suspend() noexcept { return {}; }
+                void return_void() {}
+                void unhandled_exception() { std::terminate(); }
+            };
+
+            Task(Task&& other) noexcept : handle{std::exchange(other.handle, nullptr)} {}
+
+            // never spawned
+            ~Task() {
+                if (this->handle)
+                    this->handle.destroy();
+            }
+
+            Task(Task const&) = delete;
+            Task& operator=(Task const&) = delete;
+            Task& operator=(Task&&) = delete;
+
+        private:
+            friend class Loop;
+
+            explicit Task(std::coroutine_handle<promise_type> handle) : handle{handle} {}
+
+            std::coroutine_handle<promise_type> handle;
+    };
+
+    // What child.exited()/exitedWithin() return. The coroutine is resumed by
+    // the loop once the child's pidfd is readable, with the child's final
+    // Status, or Status{} when `timeout` ran out first (the child keeps
+    // running). Lives in the coroutine's frame, so waiting allocates nothing.
+    class Exited {
+        public:
+            bool await_ready();
+            void await_suspend(std::coroutine_handle<> handle);
+            Status await_resume() { return this->child.status; }
+
+        private:
+            friend struct Child;
+            friend class Loop;
+
+            Exited(Child& child, std::int64_t timeoutMs) : child{child}, timeoutMs{timeoutMs} {}
+
+            // reaps the child, or collects its status from the Reaper
+            void collect();
+
+            Child& child;
+            std::int64_t timeoutMs; // -1: none
+            std::coroutine_handle<> waiting;
+            int pidfd = -1;
+            std::uint64_t timer = 0;
+    };
+
+    // Runs coroutines on the calling thread and resumes the ones awaiting
+    // children from a single epoll_wait() over their pidfds, with timeouts in
+    // a timer wheel of millisecond ticks: thousands of children, one thread,
+    // no std::future. Without pidfds exits are polled every millisecond.
+    // Not thread-safe: spawn() and the awaits happen on the thread in run().
+    class Loop {
+        public:
+            Loop();
+            ~Loop();
+
+            Loop(Loop const&) = delete;
+            Loop& operator=(Loop const&) = delete;
+
+            // starts on the next turn of run()
+            void spawn(Task task);
+
+            // until every spawned coroutine returned
+            void run();
+
+            // the loop in run() on this thread, or nullptr
+            static Loop* current();
+
+            std::size_t running() const { return this->tasks; }
+
+        private:
+            friend class Exited;
+            friend struct Task::promise_type;
+
+            std::uint64_t now() const;
+            void watch(Exited* exited);
+            void finish(Exited* exited, bool hasExited);
+            void poll();
+
+            std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+
+            int epollFd = -1;
+            std::size_t tasks = 0;
+            std::vector<std::coroutine_handle<>> ready;
+
+            TimerWheel<std::uint64_t> wheel; // ids of timers, they may be cancelled already
+            std::unordered_map<std::uint64_t, Exited*> timers;
+            std::uint64_t nextTimer = 1;
+            std::vector<Exited*> polled; // without a pidfd
+    };
+
+    inline Task::promise_type::~promise_type() {
+        if (this->loop != nullptr)
+            this->loop->tasks--;
+    }
+
+    // A child nobody watches: no Reaper, no future. It is reaped by the
+    // coroutine awaiting exited(), its blocking calls (wait(), terminate()...)
+    // see it as done. NO_CHILD pid with errno set when it couldn't start.
+    Child executeUnwatched(CommandLine const& commandLine,
+            std::string const& workingDirectory,
+            bool silenceOutput,
+            bool unblockSignals=true,
+            Backend backend=Backend::Spawn);
+}
+#endif // __LOOP_HPP__
@@ -0,0 +1,221 @@
+#include "OutputPump.hpp"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace process {
+    namespace {
+        // buffers of closed pipes kept for the next ones
+        constexpr auto MAX_SPARES = std::size_t{64};
+    }
+
+    OutputPump& OutputPump::instance() {
+        static OutputPump pump;
+        return pump;
+    }
+
+    OutputPump::OutputPump()
+        : epollFd{::epoll_create1(EPOLL_CLOEXEC)}, wakeFd{::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)} {
+            if (this->epollFd == -1 || this->wakeFd == -1) {
+                std::cerr << "output pump: couldn't create epoll/eventfd, one thread per pipe: errno "
+                    << errno << "\n";
+                return;
+            }
+
+            auto event = epoll_event{};
+            event.events = EPOLLIN;
+            event.data.fd = this->wakeFd;
+            ::epoll_ctl(this->epollFd, EPOLL_CTL_ADD, this->wakeFd, &event);
+
+            this->thread = std::thread{[this] { this->run(); }};
+        }
+
+    OutputPump::~OutputPump() {
+        if (this->thread.joinable()) {
+            this->stopping.store(true);
+            auto one = std::uint64_t{1};
+            if (::write(this->wakeFd, &one, sizeof(one)) == sizeof(one))
+                this->thread.join();
+            else
+                this->thread.detach();
+        }
+
+        // output of children still running is dropped
+        for (auto& [fd, source] : this->sources)
+            ::close(fd);
+        if (this->wakeFd != -1)
+            ::close(this->wakeFd);
+        if (this->epollFd != -1)
+            ::close(this->epollFd);
+    }
+
+    void OutputPump::add(int fd, Capture::Stream stream, Capture const& capture, std::function<void()> onClosed) {
+        if (capture.pipeSize != 0 && ::fcntl(fd, F_SETPIPE_SZ, static_cast<int>(capture.pipeSize)) == -1) {
+            //couldn't resize the pipe, keeps the default size
+        }
+
+        auto source = std::unique_ptr<Source>{new Source{fd, stream, capture, std::move(onClosed), nullptr}};
+        if (capture.file == -1)
+            source->buffer = this->takeBuffer(capture.bufferSize);
+
+        if (this->thread.joinable()) {
+            ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+            auto lock = std::lock_guard<std::mutex>{this->mutex};
+            auto event = epoll_event{};
+            event.events = EPOLLIN;
+            event.data.fd = fd;
+            if (::epoll_ctl(this->epollFd, EPOLL_CTL_ADD, fd, &event) == 0) {
+                this->sources.emplace(fd, std::move(source));
+                return;
+            }
+            ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+        }
+
+        // ENOMEM, no epoll...: a blocking reader per pipe
+        std::thread{[source = std::shared_ptr<Source>{std::move(source)}] {
+            while (drain(*source)) {
+            }
+            finish(*source);
+        }}.detach();
+    }
+
+    std::size_t OutputPump::pumped() const {
+        auto lock = std::lock_guard<std::mutex>{this->mutex};
+        return this->sources.size();
+    }
+
+    void OutputPump::run() {
+        epoll_event events[64];
+        while (!this->stopping.load()) {
+            auto count = ::epoll_wait(this->epollFd, events, 64, -1);
+            for (int i = 0; i < count; i++) {
+                auto fd = events[i].data.fd;
+                if (fd == this->wakeFd)
+                    continue;
+
+                // only this thread erases, the source stays put while unlocked
+                auto source = static_cast<Source*>(nullptr);
+                {
+                    auto lock = std::lock_guard<std::mutex>{this->mutex};
+                    auto it = this->sources.find(fd);
+                    if (it == this->sources.end())
+                        continue;
+                    source = it->second.get();
+                }
+                if (drain(*source))
+                    continue;
+
+                auto done = std::unique_ptr<Source>{};
+                {
+                    auto lock = std::lock_guard<std::mutex>{this->mutex};
+                    auto it = this->sources.find(fd);
+                    done = std::move(it->second);
+                    this->sources.erase(it);
+                    ::epoll_ctl(this->epollFd, EPOLL_CTL_DEL, fd, nullptr);
+                }
+                finish(*done);
+                if (done->buffer != nullptr)
+                    this->giveBack(std::move(done->buffer), done->capture.bufferSize);
+            }
+        }
+    }
+
+    bool OutputPump::drain(Source& source) {
+        auto& capture = source.capture;
+
+        if (capture.file != -1 && source.buffer == nullptr) {
+            auto size = ::splice(source.fd, nullptr, capture.file, nullptr, capture.bufferSize,
+                    SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (size > 0)
+                return true;
+            if (size == 0)
+                return false;
+            if (errno == EAGAIN || errno == EINTR)
+                return true;
+            if (errno != EINVAL)
+                return false;
+            // O_APPEND files and the like can't be spliced into, copy instead
+            source.buffer.reset(new char[capture.bufferSize]);
+        }
+
+        auto size = ::read(source.fd, source.buffer.get() + source.used, capture.bufferSize - source.used);
+        if (size == -1 && (errno == EAGAIN || errno == EINTR))
+            return true;
+        if (size <= 0) {
+            if (source.used != 0 && capture.onOutput)
+                capture.onOutput(source.stream, source.buffer.get(), source.used);
+            source.used = 0;
+            return false;
+        }
+
+        auto data = source.buffer.get();
+        if (capture.file != -1) {
+            for (auto written = ssize_t{0}; written < size;) {
+                auto n = ::write(capture.file, data + written, static_cast<std::size_t>(size - written));
+                if (n == -1 && errno != EINTR)
+                    return false;
+                written += n == -1 ? 0 : n;
+            }
+            return true;
+        }
+
+        if (capture.mode == Capture::Mode::Chunks) {
+            if (capture.onOutput)
+                capture.onOutput(source.stream, data, static_cast<std::size_t>(size));
+            return true;
+        }
+
+        auto end = source.used + static_cast<std::size_t>(size);
+        auto line = std::size_t{0};
+        for (auto i = source.used; i < end; i++) {
+            if (data[i] != '\n')
+                continue;
+            if (capture.onOutput)
+                capture.onOutput(source.stream, data + line, i - line);
+            line = i + 1;
+        }
+
+        if (line == 0 && end == capture.bufferSize) {
+            // a line longer than the buffer goes out in pieces
+            if (capture.onOutput)
+                capture.onOutput(source.stream, data, end);
+            source.used = 0;
+        } else {
+            std::memmove(data, data + line, end - line);
+            source.used = end - line;
+        }
+        return true;
+    }
+
+    void OutputPump::finish(Source& source) {
+        ::close(source.fd);
+        if (source.onClosed)
+            source.onClosed();
+    }
+
+    std::unique_ptr<char[]> OutputPump::takeBuffer(std::size_t size) {
+        if (size == Capture{}.bufferSize) {
+            auto lock = std::lock_guard<std::mutex>{this->mutex};
+            if (!this->spares.empty()) {
+                auto buffer = std::move(this->spares.back());
+                this->spares.pop_back();
+                return buffer;
+            }
+        }
+        return std::unique_ptr<char[]>{new char[size]};
+    }
+
+    void OutputPump::giveBack(std::unique_ptr<char[]> buffer, std::size_t size) {
+        auto lock = std::lock_guard<std::mutex>{this->mutex};
+        if (size == Capture{}.bufferSize && this->spares.size() < MAX_SPARES)
+            this->spares.push_back(std::move(buffer));
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef __OUTPUT_PUMP_HPP__
+#define __OUTPUT_PUMP_HPP__
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace process {
+    // What execute() does with a child's stdout/stderr when they are captured:
+    // both are pipes drained by the OutputPump thread, either spliced into
+    // `file` without passing through user space, or read into a buffer of
+    // `bufferSize` bytes and handed to `onOutput` in chunks or lines.
+    //
+    // The pump reads at most `bufferSize` bytes of a stream per wakeup and
+    // calls `onOutput` synchronously, so a slow callback (or file) stops the
+    // reads and the child blocks once its pipe is full: nothing is buffered
+    // beyond `bufferSize` and `pipeSize` per stream.
+    struct Capture {
+        enum class Stream { Out, Err };
+        enum class Mode { Chunks, Lines };
+
+        // called from the pump thread; lines come without their '\n', a line
+        // longer than bufferSize is delivered in bufferSize pieces
+        using Callback = std::function<void(Stream stream, char const* data, std::size_t size)>;
+
+        Mode mode = Mode::Chunks;
+        Callback onOutput;
+
+        // when not -1, both streams are spliced into it and onOutput isn't called
+        int file = -1;
+
+        std::size_t bufferSize = 64 * 1024;
+
+        // F_SETPIPE_SZ of each pipe, 0 keeps the kernel's default
+        std::size_t pipeSize = 0;
+    };
+
+    // One thread draining the read end of every captured pipe, registered with
+    // an epoll instance. Without epoll each pipe gets a thread blocking in read().
+    class OutputPump {
+        public:
+            static OutputPump& instance();
+
+            // takes `fd`, the read end of a pipe; `onClosed` is called from the
+            // pump thread once the write end closed and all output was delivered
+            void add(int fd, Capture::Stream stream, Capture const& capture, std::function<void()> onClosed);
+
+            // pipes currently drained
+            std::size_t pumped() const;
+
+            ~OutputPump();
+
+            OutputPump(OutputPump const&) = delete;
+            OutputPump& operator=(OutputPump const&) = delete;
+
+        private:
+            struct Source {
+                int fd;
+                Capture::Stream stream;
+                Capture capture;
+                std::function<void()> onClosed;
+                std::unique_ptr<char[]> buffer;
+                std::size_t used = 0; // start of a line not delivered yet
+            };
+
+            OutputPump();
+
+            void run();
+
+            // false once the source is exhausted
+            static bool drain(Source& source);
+            static void finish(Source& source);
+
+            std::unique_ptr<char[]> takeBuffer(std::size_t size);
+            void giveBack(std::unique_ptr<char[]> buffer, std::size_t size);
+
+            int epollFd = -1;
+            int wakeFd = -1;
+            std::atomic<bool> stopping{false};
+
+            mutable std::mutex mutex;
+            std::unordered_map<int, std::unique_ptr<Source>> sources; // by fd
+
+            // default-sized buffers of closed sources, reused by the next ones
+            std::vector<std::unique_ptr<char[]>> spares;
+
+            std::thread thread;
+    };
+}
+#endif // __OUTPUT_PUMP_HPP__
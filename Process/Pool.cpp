@@ -0,0 +1,162 @@
+#include "Pool.hpp"
+#include "../ScopedTimer/LatencyHistogram.hpp"
+
+#include <algorithm>
+#include <cerrno>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace process {
+    Pool::Pool(CommandLine commandLine, Options options)
+        : commandLine{std::move(commandLine)}, options{std::move(options)},
+        target{std::min(this->options.minIdle, this->options.maxIdle)},
+        lastMiss{std::chrono::steady_clock::now()}, acquisitions{new LatencyHistogram{}} {
+            this->thread = std::thread{[this] { this->run(); }};
+        }
+
+    Pool::~Pool() {
+        {
+            auto lock = std::lock_guard<std::mutex>{this->mutex};
+            this->stopping = true;
+        }
+        this->changed.notify_all();
+        this->thread.join();
+
+        for (auto& helper : this->idle)
+            release(helper);
+    }
+
+    Child Pool::acquire(std::string const& input, Capture::Callback onOutput) {
+        auto begin = std::chrono::steady_clock::now();
+        auto helper = Helper{};
+        {
+            auto lock = std::lock_guard<std::mutex>{this->mutex};
+            while (!this->idle.empty()) {
+                helper = std::move(this->idle.front());
+                this->idle.pop_front();
+                if (!helper.child.isReady())
+                    break;
+
+                // died while idle, it's already reaped
+                ::close(helper.input);
+                helper.child.wait();
+                helper = Helper{};
+            }
+
+            if (helper.input != -1) {
+                this->hits++;
+            } else {
+                this->misses++;
+                this->target = std::min(this->target + 1, this->options.maxIdle);
+                this->lastMiss = begin;
+            }
+        }
+        this->changed.notify_one();
+
+        if (helper.input == -1)
+            helper = this->start();
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin);
+        {
+            auto lock = std::lock_guard<std::mutex>{this->mutex};
+            this->acquisitions->record(static_cast<std::uint64_t>(elapsed.count()));
+        }
+
+        if (helper.input == -1)
+            return Child{};
+
+        {
+            auto lock = std::lock_guard<std::mutex>{helper.route->mutex};
+            helper.route->onOutput = std::move(onOutput);
+        }
+
+        // a helper that exited early makes this fail, its status tells why
+        for (auto sent = std::size_t{0}; sent < input.size();) {
+            auto n = ::send(helper.input, input.data() + sent, input.size() - sent, MSG_NOSIGNAL);
+            if (n == -1 && errno != EINTR)
+                break;
+            sent += n == -1 ? 0 : static_cast<std::size_t>(n);
+        }
+        ::close(helper.input);
+
+        return std::move(helper.child);
+    }
+
+    Pool::Metrics Pool::metrics() const {
+        auto snapshot = HistogramSnapshot{};
+        auto metrics = Metrics{};
+        {
+            auto lock = std::lock_guard<std::mutex>{this->mutex};
+            this->acquisitions->addTo(snapshot);
+            metrics.hits = this->hits;
+            metrics.misses = this->misses;
+            metrics.idle = this->idle.size();
+            metrics.target = this->target;
+        }
+        metrics.p50 = snapshot.percentile(0.50);
+        metrics.p99 = snapshot.percentile(0.99);
+        return metrics;
+    }
+
+    Pool::Helper Pool::start() {
+        int sockets[2] = {-1, -1};
+        if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) == -1)
+            return Helper{};
+
+        auto route = std::make_shared<Route>();
+        auto capture = this->options.capture;
+        capture.onOutput = [route](Capture::Stream stream, char const* data, std::size_t size) {
+            auto lock = std::lock_guard<std::mutex>{route->mutex};
+            if (route->onOutput)
+                route->onOutput(stream, data, size);
+        };
+
+        auto child = execute(this->commandLine, this->options.workingDirectory, sockets[1], capture);
+        ::close(sockets[1]);
+        if (child.pid == process::NO_CHILD) {
+            ::close(sockets[0]);
+            return Helper{};
+        }
+        return Helper{std::move(child), sockets[0], std::move(route)};
+    }
+
+    // keeps `target` helpers idle, shrinks it when no acquire() missed for a while
+    void Pool::run() {
+        auto lock = std::unique_lock<std::mutex>{this->mutex};
+        while (!this->stopping) {
+            if (this->idle.size() < this->target) {
+                lock.unlock();
+                auto helper = this->start();
+                lock.lock();
+                if (helper.input != -1)
+                    this->idle.push_back(std::move(helper));
+                else
+                    this->changed.wait_for(lock, this->options.shrinkAfter);
+                continue;
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            if (this->target > this->options.minIdle && now - this->lastMiss >= this->options.shrinkAfter) {
+                this->target--;
+                this->lastMiss = now;
+                if (this->idle.size() > this->target) {
+                    auto extra = std::move(this->idle.back());
+                    this->idle.pop_back();
+                    lock.unlock();
+                    release(extra);
+                    lock.lock();
+                }
+                continue;
+            }
+
+            this->changed.wait_for(lock, this->options.shrinkAfter);
+        }
+    }
+
+    // killed before its stdin closes, so it never runs with an empty input
+    void Pool::release(Helper& helper) {
+        helper.child.terminate();
+        ::close(helper.input);
+    }
+}
@@ -0,0 +1,102 @@
+#ifndef __POOL_HPP__
+#define __POOL_HPP__
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "Process.hpp"
+
+class LatencyHistogram;
+
+namespace process {
+    // Prewarmed helpers running one command. The pool starts them ahead of time
+    // with stdin on a socket, so they exec, load and initialize, then block
+    // reading their input. acquire() hands one out by sending it its input and
+    // closing the socket; from there it is a plain Child that runs and exits.
+    //
+    // A helper runs one job: recycling a slot means starting its replacement,
+    // which the pool thread does in the background. The number of idle helpers
+    // grows by one on every miss and shrinks by one per `shrinkAfter` without a
+    // miss, within [minIdle, maxIdle].
+    class Pool {
+        public:
+            struct Options {
+                std::size_t minIdle = 1;
+                std::size_t maxIdle = 16;
+                std::chrono::milliseconds shrinkAfter{1000};
+                std::string workingDirectory;
+
+                // mode, buffer and pipe sizes of the helpers' output, onOutput is per acquire()
+                Capture capture;
+            };
+
+            struct Metrics {
+                std::uint64_t hits = 0;
+                std::uint64_t misses = 0;
+                std::uint64_t p50 = 0; // acquisition latency, ns
+                std::uint64_t p99 = 0;
+                std::size_t idle = 0;
+                std::size_t target = 0;
+
+                double hitRate() const {
+                    return this->hits + this->misses == 0 ? 0.0
+                        : static_cast<double>(this->hits) / static_cast<double>(this->hits + this->misses);
+                }
+            };
+
+            Pool(CommandLine commandLine, Options options);
+
+            // idle helpers are killed, acquired ones are left alone
+            ~Pool();
+
+            Pool(Pool const&) = delete;
+            Pool& operator=(Pool const&) = delete;
+
+            // a helper running with `input` as its whole stdin, prewarmed when one
+            // was idle, started on the spot otherwise; an empty Child when starting
+            // failed. Its output goes to `onOutput`, from the OutputPump thread.
+            Child acquire(std::string const& input, Capture::Callback onOutput = {});
+
+            Metrics metrics() const;
+
+        private:
+            // where a helper's output goes, set once it is acquired
+            struct Route {
+                std::mutex mutex;
+                Capture::Callback onOutput;
+            };
+
+            struct Helper {
+                Child child;
+                int input = -1; // our end of its stdin
+                std::shared_ptr<Route> route;
+            };
+
+            Helper start();
+            void run();
+
+            static void release(Helper& helper);
+
+            CommandLine commandLine;
+            Options options;
+
+            mutable std::mutex mutex;
+            std::condition_variable changed;
+            std::deque<Helper> idle;
+            std::size_t target;
+            std::chrono::steady_clock::time_point lastMiss;
+            std::uint64_t hits = 0;
+            std::uint64_t misses = 0;
+            std::unique_ptr<LatencyHistogram> acquisitions; // written under mutex
+            bool stopping = false;
+
+            std::thread thread;
+    };
+}
+#endif // __POOL_HPP__
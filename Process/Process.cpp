@@ -1,17 +1,286 @@
 #include "Process.hpp"
+#include "Deadlines.hpp"
+#include "Reaper.hpp"
 
-#include <iostream>
+#include <atomic>
 #include <cassert>
+#include <cerrno>
+#include <climits>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 namespace process {
+    namespace {
+        // mkdir -p without allocating, it runs in the forked child
+        bool makeDirs(char const* path) {
+            char buffer[PATH_MAX];
+            auto size = std::strlen(path);
+            if (size == 0 || size >= sizeof(buffer))
+                return false;
+            std::memcpy(buffer, path, size + 1);
+
+            for (auto i = size_t{1}; i <= size; i++) {
+                if (buffer[i] != '/' && buffer[i] != '\0')
+                    continue;
+                auto c = buffer[i];
+                buffer[i] = '\0';
+                if (::mkdir(buffer, 0755) == -1 && errno != EEXIST)
+                    return false;
+                buffer[i] = c;
+            }
+            errno = 0;
+            return true;
+        }
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 29)
+        constexpr auto SPAWN_CHDIR = true;
+        int addChdir(posix_spawn_file_actions_t* actions, char const* path) {
+            return ::posix_spawn_file_actions_addchdir_np(actions, path);
+        }
+#else
+        constexpr auto SPAWN_CHDIR = false;
+        int addChdir(posix_spawn_file_actions_t*, char const*) { return ENOSYS; }
+#endif
+
+        // what the child gets: stdin/stdout/stderr (-1 inherits the parent's),
+        // its process group (0 makes it the leader of a new one) and the
+        // cgroup.procs it moves itself to before exec (fork only)
+        struct Setup {
+            int out = -1;
+            int err = -1;
+            int in = -1;
+            pid_t group = 0;
+            int cgroup = -1;
+        };
+
+        // the posix_spawn() path of execute(): same process group, signal mask,
+        // output and working directory handling as the forked child, exec errors
+        // are returned by posix_spawn() itself instead of through a pipe
+        pid_t spawn(CommandLine const& commandLine,
+                std::string const& workingDirectory,
+                Setup setup,
+                bool unblockSignals) {
+            if (workingDirectory != "" && !makeDirs(workingDirectory.c_str())) {
+                //couldn't create working directory
+                return process::NO_CHILD;
+            }
+
+            // the forked child keeps SIGINT/SIGTERM/SIGQUIT blocked unless asked not to
+            auto mask = sigset_t{0};
+            ::sigprocmask(SIG_SETMASK, NULL, &mask);
+            if (!unblockSignals) {
+                ::sigaddset(&mask, SIGINT);
+                ::sigaddset(&mask, SIGTERM);
+                ::sigaddset(&mask, SIGQUIT);
+            }
+
+            posix_spawnattr_t attributes;
+            posix_spawn_file_actions_t actions;
+            ::posix_spawnattr_init(&attributes);
+            ::posix_spawn_file_actions_init(&actions);
+
+            auto code = ::posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGMASK);
+            if (code == 0)
+                code = ::posix_spawnattr_setpgroup(&attributes, setup.group);
+            if (code == 0)
+                code = ::posix_spawnattr_setsigmask(&attributes, &mask);
+            if (code == 0 && setup.in != -1)
+                code = ::posix_spawn_file_actions_adddup2(&actions, setup.in, STDIN_FILENO);
+            if (code == 0 && setup.out != -1)
+                code = ::posix_spawn_file_actions_adddup2(&actions, setup.out, STDOUT_FILENO);
+            if (code == 0 && setup.err != -1)
+                code = ::posix_spawn_file_actions_adddup2(&actions, setup.err, STDERR_FILENO);
+            if (code == 0 && workingDirectory != "")
+                code = addChdir(&actions, workingDirectory.c_str());
+
+            auto pid = process::NO_CHILD;
+            if (code == 0)
+                code = ::posix_spawn(&pid, commandLine.argv()[0], &actions, &attributes, commandLine.argv(),
+                        commandLine.envp() != nullptr ? commandLine.envp() : ::environ);
+
+            ::posix_spawn_file_actions_destroy(&actions);
+            ::posix_spawnattr_destroy(&attributes);
+
+            if (code != 0) {
+                errno = code;
+                //couldn't execute commandLine
+                return process::NO_CHILD;
+            }
+
+            return pid;
+        }
+
+        // the fork() path of execute(), errors of the child come back through a pipe
+        pid_t forkExec(CommandLine const& commandLine,
+                std::string const& workingDirectory,
+                Setup setup,
+                bool unblockSignals) {
+            auto pid = process::NO_CHILD;
+            int pipefd[2] = {};
+
+            // close-on-exec: a successful exec closes the write end, so the read below
+            // returns as soon as the child runs commandLine, not when it exits
+            if (::pipe2(pipefd, O_CLOEXEC) == -1)
+            {
+              //"unable to create pipe"
+              return process::NO_CHILD;
+            }
+
+            auto mask = sigset_t{0};
+            auto omask = sigset_t{0};
+            ::sigemptyset(&mask);
+            ::sigaddset(&mask, SIGINT);
+            ::sigaddset(&mask, SIGTERM);
+            ::sigaddset(&mask, SIGQUIT);
+            ::sigprocmask(SIG_BLOCK, &mask, &omask);
+
+            errno = 0;
+            // the child only reads what was prepared here: no allocation after fork()
+            if ((pid = ::fork()) == 0) {
+
+                if (setup.in != -1 && ::dup2(setup.in, STDIN_FILENO) == -1) {
+                    //(child) couldn't redirect stdin
+                } else if (setup.out != -1 && ::dup2(setup.out, STDOUT_FILENO) == -1) {
+                    //(child) couldn't redirect stdout
+                } else if (setup.err != -1 && ::dup2(setup.err, STDERR_FILENO) == -1) {
+                    //(child) couldn't redirect stderr
+                } else if (::setpgid(0, setup.group) == -1) {
+                    //(child) unable to change to own process group"
+                } else if (setup.cgroup != -1 && ::write(setup.cgroup, "0", 1) != 1) {
+                    //(child) couldn't move to its cgroup
+                } else if (unblockSignals && ::sigprocmask(SIG_SETMASK, &omask, NULL)) {
+                    //"(child) couldn't set original signal mask"
+                } else if (::close(pipefd[0]) == -1) {
+                    //"(child) couldn't close pipefd[0]"
+                } else if (workingDirectory != "" && !makeDirs(workingDirectory.c_str())) {
+                    //(child) couldn't change working directory to workingDirectory
+                } else if (workingDirectory != "" && ::chdir(workingDirectory.c_str()) == -1) {
+                    //(child) couldn't change working directory to workingDirectory);
+                } else if (commandLine.envp() == nullptr && ::execv(commandLine.argv()[0], commandLine.argv()) == -1) {
+                    //(child) couldn't execute:", commandLine
+                } else if (::execve(commandLine.argv()[0], commandLine.argv(), commandLine.envp()) == -1) {
+                    //(child) couldn't execute:", commandLine
+                }
+
+                auto code = errno;
+                errno = 0;
+                if (::write(pipefd[1], &code, sizeof(code)) != sizeof(code)) {
+                    //(child) couldn't write error to parent
+                    ::close(pipefd[1]);
+                    ::_exit(errno);
+                }
+
+                ::close(pipefd[1]);
+                ::_exit(255);
+            }
+
+            if (pid == process::NO_CHILD)
+            {
+              //unable to fork new process for child
+              ::sigprocmask(SIG_SETMASK, &omask, NULL);
+              ::close(pipefd[0]);
+              ::close(pipefd[1]);
+              return process::NO_CHILD;
+            }
+
+            errno = 0;
+            if (::setpgid(pid, setup.group == 0 ? pid : setup.group) == -1 && errno != EACCES) {
+                //unable to change child process group
+            } else if (::sigprocmask(SIG_SETMASK, &omask, NULL) == -1) {
+                //unable to restore process signal mask
+            } else if (::close(pipefd[1]) == -1) {
+                //couldn't close pipefd[1]
+            }
+
+            auto code = errno = 0;
+            ::read(pipefd[0], &code, sizeof(code));
+            ::close(pipefd[0]);
+
+            if (code != 0) {
+                errno = code;
+                //couldn't execute commandLine
+
+                int wstatus = 0;
+                ::waitpid(pid, &wstatus, 0);
+
+                auto result = Status{wstatus};
+                assert(result.exited);
+                assert(result.exitStatus == 255);
+
+                // unable to execute commandLine in child
+                return process::NO_CHILD;
+            }
+
+            return pid;
+        }
+
+        pid_t start(CommandLine const& commandLine,
+                std::string const& workingDirectory,
+                Setup setup,
+                bool unblockSignals,
+                Backend backend) {
+            std::cout << "running" << commandLine.text() << "\n";
+
+            if (!commandLine.valid()) {
+                //unbalanced quotes in commandLine
+                errno = EINVAL;
+                return process::NO_CHILD;
+            } else if (commandLine.size() == 0) {
+                errno = ENOENT;
+                return process::NO_CHILD;
+            }
+
+            if (backend == Backend::Spawn && (SPAWN_CHDIR || workingDirectory == "") && setup.cgroup == -1)
+                return spawn(commandLine, workingDirectory, setup, unblockSignals);
+            return forkExec(commandLine, workingDirectory, setup, unblockSignals);
+        }
+
+        pid_t start(CommandLine const& commandLine,
+                std::string const& workingDirectory,
+                bool silenceOutput,
+                Setup setup,
+                bool unblockSignals,
+                Backend backend) {
+            if (silenceOutput) {
+                setup.out = setup.err = ::open("/dev/null", O_RDWR | O_CLOEXEC);
+                if (setup.out == -1) {
+                    //error : "couldn't open /dev/null for silencing"
+                }
+            }
+
+            auto pid = start(commandLine, workingDirectory, setup, unblockSignals, backend);
+            if (setup.out != -1)
+                ::close(setup.out);
+            return pid;
+        }
+    }
+
     Status::Status(int wstatus)
         : exited{WIFEXITED(wstatus)}, signaled{WIFSIGNALED(wstatus)},
         crashed{signaled ? WCOREDUMP(wstatus) == 1 : false},
         paused{WIFSTOPPED(wstatus)}, resumed{WIFCONTINUED(wstatus)},
-        exitStatus{exited ? static_cast<int8_t>(WEXITSTATUS(wstatus)) : 0},
+        exitStatus{exited ? WEXITSTATUS(wstatus) : 0},
         signal{signaled ? WTERMSIG(wstatus) : 0},
         pauseSignal{paused ? WSTOPSIG(wstatus) : 0}, wstatus{wstatus} {}
 
+    Status::Status(int wstatus, struct rusage const& usage)
+        : Status{wstatus} {
+            this->userTime = std::chrono::seconds(usage.ru_utime.tv_sec) + std::chrono::microseconds(usage.ru_utime.tv_usec);
+            this->systemTime = std::chrono::seconds(usage.ru_stime.tv_sec) + std::chrono::microseconds(usage.ru_stime.tv_usec);
+            this->maxRssKb = usage.ru_maxrss;
+            this->majorFaults = usage.ru_majflt;
+            this->minorFaults = usage.ru_minflt;
+        }
+
     bool Status::isStillRunning() const
     {
         return !signaled && !exited;
@@ -27,20 +296,21 @@ namespace process {
 
     Child::Child(pid_t pid)
         : pid{pid} {
+            assert(pid != process::NO_CHILD);
             std::cout << "will monitor pid:" << pid << "\n";
-            auto task = std::packaged_task<Status()>{[pid] {
-                assert(pid != process::NO_CHILD);
-                int wstatus = 0;
-                while (::waitpid(pid, &wstatus, 0) != pid && errno == EINTR) {
-                    errno = 0;
-                }
-                Status s{wstatus};
-                std::cout << "monitoring of pid:" << pid << "ended with wstatus:" << wstatus << " status:" << s << "\n";
-                return s;
-            }};
 
-            this->futureStatus = std::move(task.get_future());
-            std::thread{std::move(task)}.detach();
+            auto promise = std::make_shared<std::promise<Status>>();
+            this->futureStatus = promise->get_future();
+            Reaper::instance().watch(pid, [pid, promise](Status s) {
+                std::cout << "monitoring of pid:" << pid << "ended with wstatus:" << s.wstatus << " status:" << s << "\n";
+                promise->set_value(s);
+            });
+        }
+
+    Child::Child(pid_t pid, std::future<Status> futureStatus)
+        : pid{pid}, futureStatus{std::move(futureStatus)} {
+            assert(pid != process::NO_CHILD);
+            std::cout << "will monitor pid:" << pid << "\n";
         }
 
     bool operator==(Child const& a, Child const& b) { return a.pid == b.pid; }
@@ -180,7 +450,7 @@ namespace process {
             std::cout << "Process is still running.\n";
             auto status = wait(timeout);
             if (status.isStillRunning()) {
-                std:: << "Process took too long to stop.\n";
+                std::cout << "Process took too long to stop.\n";
                 terminate();
             }
         }
@@ -189,142 +459,127 @@ namespace process {
     Child execute(std::string const& commandLine,
             std::string const& workingDirectory,
             bool silenceOutput,
-            bool unblockSignals) {
-        auto pid = process::NO_CHILD;
-        int pipefd[2] = {};
+            bool unblockSignals,
+            Backend backend) {
+        return execute(CommandLine{commandLine}, workingDirectory, silenceOutput, unblockSignals, backend);
+    }
 
-        std::cout << "running" << commandLine << "\n";
+    Child execute(CommandLine const& commandLine,
+            std::string const& workingDirectory,
+            bool silenceOutput,
+            bool unblockSignals,
+            Backend backend) {
+        auto pid = launch(commandLine, workingDirectory, silenceOutput, 0, unblockSignals, backend);
+        return pid == process::NO_CHILD ? Child{} : Child{pid};
+    }
 
-        if (::pipe(pipefd) == -1)
-        {
-          //"unable to create pipe"
-          return;
+    Child execute(CommandLine const& commandLine,
+            std::string const& workingDirectory,
+            bool silenceOutput,
+            CGroup::Limits const& limits,
+            bool unblockSignals) {
+        auto cgroup = std::make_shared<CGroup>(limits);
+        if (!cgroup->valid()) {
+            //couldn't create the cgroup leaf
+            return Child{};
         }
 
-        auto mask = sigset_t{0};
-        auto omask = sigset_t{0};
-        ::sigemptyset(&mask);
-        ::sigaddset(&mask, SIGINT);
-        ::sigaddset(&mask, SIGTERM);
-        ::sigaddset(&mask, SIGQUIT);
-        ::sigprocmask(SIG_BLOCK, &mask, &omask);
-
-        errno = 0;
-        if ((pid = ::fork()) == 0) {
-            auto arguments = std::vector<char*>{};
-            auto args = commandLine;
-
-            {
-                size_t i = 0;
-                while (i < args.size()) {
-                    arguments.emplace_back(&args[i]);
-
-                    do {
-                        i = args.find_first_of("\"' \t", i);
-                        if (i == std::string::npos || (i == 0 || args[i - 1] != '\\'))
-                            break;
-                    } while (true);
-                    if (i == std::string::npos)
-                        break;
-
-                    // skip quoted arguments until the next corresponding quote
-                    if (args[i] == '"' || args[i] == '\'') {
-                        do {
-                            i = args.find_first_of(args[i], i + 1);
-                            if (i == std::string::npos || (i == 0 || args[i - 1] != '\\'))
-                                break;
-                        } while (true);
-                        if (i == std::string::npos)
-                            break;
-                        i++;
-
-                        // FIXME: here we could loop back to whitespace / quotes search above,
-                        // but we will instead assume that there won't be tricks in the
-                        // command-line.
-                        assert(i == args.size() || args[i] == ' ' || args[i] == '\t');
-                    }
-
-                    // ignore any number of whitespace between arguments
-                    while (i < args.size() && (args[i] == ' ' || args[i] == '\t')) {
-                        args[i] = '\0';
-                        i++;
-                    }
-                }
+        auto setup = Setup{};
+        setup.cgroup = cgroup->procsFd();
+        auto pid = start(commandLine, workingDirectory, silenceOutput, setup, unblockSignals, Backend::Fork);
+        if (pid == process::NO_CHILD)
+            return Child{};
+
+        auto promise = std::make_shared<std::promise<Status>>();
+        auto child = Child{pid, promise->get_future()};
+        Reaper::instance().watch(pid, [pid, promise, cgroup](Status s) mutable {
+            std::cout << "monitoring of pid:" << pid << "ended with wstatus:" << s.wstatus << " status:" << s << "\n";
+            s.cgroup = cgroup->usage();
+            // leftovers are killed, the leaf is gone before the status is; they
+            // may take a few ms to leave it, waited for by the deadline thread
+            if (cgroup->remove()) {
+                promise->set_value(s);
+                return;
             }
-            arguments.emplace_back(nullptr);
-
-            setStaskSize(0, s_child_process_stacksize);
+            Deadlines::instance().retry(std::chrono::milliseconds{1}, [cgroup, promise, s] {
+                if (!cgroup->remove())
+                    return false;
+                promise->set_value(s);
+                return true;
+            });
+        });
+        return child;
+    }
 
-            if (silenceOutput) {
-                int devnull = open("/dev/null", O_RDWR);
-                if (-1 != devnull) {
-                    //(child) silencing stdout/stderr
-                    dup2(devnull, STDOUT_FILENO);
-                    dup2(devnull, STDERR_FILENO);
-                    close(devnull);
-                } else {
-                    //error : "(child) couldn't open /dev/null for silencing"
-                }
-            }
+    pid_t launch(CommandLine const& commandLine,
+            std::string const& workingDirectory,
+            bool silenceOutput,
+            pid_t processGroup,
+            bool unblockSignals,
+            Backend backend) {
+        auto setup = Setup{};
+        setup.group = processGroup;
+        return start(commandLine, workingDirectory, silenceOutput, setup, unblockSignals, backend);
+    }
 
-            if (::setpgid(0, 0) == -1)
-                //(child) unable to change to own process group"
-            else if (unblockSignals && ::sigprocmask(SIG_SETMASK, &omask, NULL))
-                //"(child) couldn't set original signal mask"
-            else if (::close(pipefd[0]) == -1)
-                //"(child) couldn't close pipefd[0]"
-            else if (workingDirectory != "" &&
-                    filesystem::makeDirs(workingDirectory.c_str()).getError() != NO_ERROR)
-                //(child) couldn't change working directory to workingDirectory
-            else if (workingDirectory != "" && ::chdir(workingDirectory.c_str()) == -1)
-                //(child) couldn't change working directory to workingDirectory);
-            else if (::execv(arguments[0], &arguments[0]) == -1)
-                //(child) couldn't execute:", commandLine
+    Child execute(CommandLine const& commandLine,
+            std::string const& workingDirectory,
+            Capture const& capture,
+            bool unblockSignals,
+            Backend backend) {
+        return execute(commandLine, workingDirectory, -1, capture, unblockSignals, backend);
+    }
 
+    Child execute(CommandLine const& commandLine,
+            std::string const& workingDirectory,
+            int input,
+            Capture const& capture,
+            bool unblockSignals,
+            Backend backend) {
+        int out[2] = {-1, -1};
+        int err[2] = {-1, -1};
+        if (::pipe2(out, O_CLOEXEC) == -1 || ::pipe2(err, O_CLOEXEC) == -1) {
+            //"unable to create pipe"
             auto code = errno;
-            errno = 0;
-            if (::write(pipefd[1], &code, sizeof(code)) != sizeof(code)) {
-                //(child) couldn't write error to parent
-                ::close(pipefd[1]);
-                std::exit(errno);
-            }
-
-            ::close(pipefd[1]);
-            std::exit(255);
+            for (auto fd : {out[0], out[1], err[0], err[1]})
+                if (fd != -1)
+                    ::close(fd);
+            errno = code;
+            return Child{};
         }
 
-        if (pid == process::NO_CHILD)
-        {
-          //unable to fork new process for child
+        auto pid = start(commandLine, workingDirectory, Setup{out[1], err[1], input}, unblockSignals, backend);
+        ::close(out[1]);
+        ::close(err[1]);
+        if (pid == process::NO_CHILD) {
+            ::close(out[0]);
+            ::close(err[0]);
+            return Child{};
         }
 
-        errno = 0;
-        if (::setpgid(pid, pid) == -1 && errno != EACCES)
-            //unable to change child process group
-        else if (::sigprocmask(SIG_SETMASK, &omask, NULL) == -1)
-            //unable to restore process signal mask
-        else if (::close(pipefd[1]) == -1)
-            //couldn't close pipefd[1]
-
-        auto code = errno = 0;
-        ::read(pipefd[0], &code, sizeof(code));
-        ::close(pipefd[0]);
-
-        if (code != 0) {
-            errno = code;
-            //couldn't execute commandLine
-
-            int wstatus = 0;
-            ::waitpid(pid, &wstatus, 0);
-
-            auto result = Status{wstatus};
-            assert(result.exited);
-            assert(result.exitStatus == 255);
+        // ready after the exit and both end-of-files, whichever comes last
+        struct Pending {
+            std::promise<Status> promise;
+            Status status;
+            std::atomic<int> remaining{3};
 
-            // unable to execute commandLine in child
-        }
-
-        return Child{pid};
+            void done() {
+                if (this->remaining.fetch_sub(1) == 1)
+                    this->promise.set_value(this->status);
+            }
+        };
+        auto pending = std::make_shared<Pending>();
+        auto child = Child{pid, pending->promise.get_future()};
+
+        auto& pump = OutputPump::instance();
+        pump.add(out[0], Capture::Stream::Out, capture, [pending] { pending->done(); });
+        pump.add(err[0], Capture::Stream::Err, capture, [pending] { pending->done(); });
+        Reaper::instance().watch(pid, [pid, pending](Status s) {
+            std::cout << "monitoring of pid:" << pid << "ended with wstatus:" << s.wstatus << " status:" << s << "\n";
+            pending->status = s;
+            pending->done();
+        });
+        return child;
     }
 
     void daemonize() {
@@ -332,7 +587,6 @@ namespace process {
         {
           //"unable to daemonize
         }
-        return NO_ERROR;
     }
 
 }
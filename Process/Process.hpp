@@ -2,7 +2,17 @@
 #define __PROCESS_HPP__
 
 #include <chrono>
+#include <cstdint>
 #include <future>
+#include <ostream>
+#include <string>
+
+#include <sys/resource.h>
+#include <sys/types.h>
+
+#include "CGroup.hpp"
+#include "CommandLine.hpp"
+#include "OutputPump.hpp"
 
 namespace process {
     static constexpr auto NO_CHILD = pid_t{-1};
@@ -10,6 +20,9 @@ namespace process {
     struct Status {
         Status(int wstatus);
 
+        // as reaped by wait4()
+        Status(int wstatus, struct rusage const& usage);
+
         Status() = default;
         Status(Status const&) = default;
         Status(Status&&) = default;
@@ -28,9 +41,22 @@ namespace process {
         int pauseSignal = 0;
 
         int wstatus = 0;
+
+        // what the child itself (and the descendants it waited for) cost,
+        // zero when it wasn't reaped with wait4()
+        std::chrono::microseconds userTime{0};
+        std::chrono::microseconds systemTime{0};
+        long maxRssKb = 0;
+        long majorFaults = 0;
+        long minorFaults = 0;
+
+        // what its whole cgroup leaf cost, zero when it didn't run in one
+        CGroup::Usage cgroup;
     };
     std::ostream& operator<<(std::ostream& out, Status const& s);
 
+    class Exited; // Loop.hpp
+
     struct Child {
         Status status = {};
         pid_t pid = NO_CHILD;
@@ -38,6 +64,9 @@ namespace process {
 
         Child(pid_t pid);
 
+        // `futureStatus` is fulfilled by whoever watches the child instead of the Reaper
+        Child(pid_t pid, std::future<Status> futureStatus);
+
         Child() = default;
         Child(Child&&) = default;
         Child& operator=(Child&&) = default;
@@ -59,18 +88,73 @@ namespace process {
         Status pause();
         Status resume();
 
+        // blocks the caller for up to `timeout`, Deadlines does it for many children at once
         void waitThenTerminate(std::chrono::nanoseconds const& timeout);
 
+        // `co_await child.exited()` in a coroutine run by a process::Loop (C++20)
+        Exited exited();
+        Exited exitedWithin(std::chrono::nanoseconds const& timeout);
+
         friend bool operator==(Child const& a, Child const& b);
         friend bool operator!=(Child const& a, Child const& b);
     };
 
+    // how execute() creates the child: posix_spawn() doesn't copy the parent's
+    // page tables (glibc clones with CLONE_VM|CLONE_VFORK), so its cost doesn't
+    // grow with the parent's RSS. Fork is used when spawn can't honour a request,
+    // i.e. a working directory without posix_spawn_file_actions_addchdir_np().
+    enum class Backend { Spawn, Fork };
+
     Child execute(std::string const& commandLine,
             std::string const& workingDirectory,
             bool silenceOutput,
-            TransitionEvents&& events = TransitionEvents(),
+            bool unblockSignals=true,
+            Backend backend=Backend::Spawn);
+
+    // for commands launched repeatedly: `commandLine` is split once, not per call
+    Child execute(CommandLine const& commandLine,
+            std::string const& workingDirectory,
+            bool silenceOutput,
+            bool unblockSignals=true,
+            Backend backend=Backend::Spawn);
+
+    // stdout/stderr go to pipes drained by the OutputPump; the child's status
+    // is ready once it exited and both pipes were drained
+    Child execute(CommandLine const& commandLine,
+            std::string const& workingDirectory,
+            Capture const& capture,
+            bool unblockSignals=true,
+            Backend backend=Backend::Spawn);
+
+    // as above, the child's stdin is a dup of `input`, which the caller keeps
+    Child execute(CommandLine const& commandLine,
+            std::string const& workingDirectory,
+            int input,
+            Capture const& capture,
+            bool unblockSignals=true,
+            Backend backend=Backend::Spawn);
+
+    // in a cgroup leaf of its own, removed once the child exited: the limits
+    // apply to it and everything it starts, and its Status gets the leaf's
+    // cpu.stat and memory.peak. A process can't be spawned into a cgroup by
+    // posix_spawn(), so this always forks. NO_CHILD pid with errno set when
+    // the leaf couldn't be created or a limit couldn't be applied.
+    Child execute(CommandLine const& commandLine,
+            std::string const& workingDirectory,
+            bool silenceOutput,
+            CGroup::Limits const& limits,
             bool unblockSignals=true);
 
+    // what execute() runs on: starts commandLine in `processGroup` (0 for a new
+    // one led by the child) and returns its pid, or NO_CHILD with errno set.
+    // Nothing watches the child, the caller reaps it.
+    pid_t launch(CommandLine const& commandLine,
+            std::string const& workingDirectory,
+            bool silenceOutput,
+            pid_t processGroup,
+            bool unblockSignals=true,
+            Backend backend=Backend::Spawn);
+
     void daemonize();
 }
 #endif // __PROCESS_HPP__
@@ -0,0 +1,152 @@
+#include "Reaper.hpp"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <iostream>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace process {
+    int pidfdOpen(pid_t pid) {
+#ifdef SYS_pidfd_open
+        return static_cast<int>(::syscall(SYS_pidfd_open, pid, 0));
+#else
+        errno = ENOSYS;
+        return -1;
+#endif
+    }
+
+    namespace {
+        int pidfdSendSignal(int pidfd, int signal) {
+#ifdef SYS_pidfd_send_signal
+            return static_cast<int>(::syscall(SYS_pidfd_send_signal, pidfd, signal, nullptr, 0));
+#else
+            errno = ENOSYS;
+            return -1;
+#endif
+        }
+
+        Status waitFor(pid_t pid) {
+            int wstatus = 0;
+            auto usage = rusage{};
+            while (::wait4(pid, &wstatus, 0, &usage) != pid && errno == EINTR) {
+                errno = 0;
+            }
+            return Status{wstatus, usage};
+        }
+    }
+
+    Reaper& Reaper::instance() {
+        static Reaper reaper;
+        return reaper;
+    }
+
+    Reaper::Reaper()
+        : epollFd{::epoll_create1(EPOLL_CLOEXEC)}, wakeFd{::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)} {
+            if (this->epollFd == -1 || this->wakeFd == -1) {
+                std::cerr << "reaper: couldn't create epoll/eventfd, one thread per child: errno "
+                    << errno << "\n";
+                return;
+            }
+
+            auto event = epoll_event{};
+            event.events = EPOLLIN;
+            event.data.fd = this->wakeFd;
+            ::epoll_ctl(this->epollFd, EPOLL_CTL_ADD, this->wakeFd, &event);
+
+            this->thread = std::thread{[this] { this->run(); }};
+        }
+
+    Reaper::~Reaper() {
+        if (this->thread.joinable()) {
+            this->stopping.store(true);
+            auto one = std::uint64_t{1};
+            if (::write(this->wakeFd, &one, sizeof(one)) == sizeof(one))
+                this->thread.join();
+            else
+                this->thread.detach();
+        }
+
+        // children still running are not waited for
+        for (auto& [pidfd, watch] : this->watches)
+            ::close(pidfd);
+        if (this->wakeFd != -1)
+            ::close(this->wakeFd);
+        if (this->epollFd != -1)
+            ::close(this->epollFd);
+    }
+
+    void Reaper::watch(pid_t pid, Callback onExit) {
+        auto pidfd = this->thread.joinable() ? pidfdOpen(pid) : -1;
+        if (pidfd != -1) {
+            auto lock = std::lock_guard<std::mutex>{this->mutex};
+            this->watches.emplace(pidfd, Watch{pid, std::move(onExit)});
+            this->pidfds[pid] = pidfd;
+
+            auto event = epoll_event{};
+            event.events = EPOLLIN;
+            event.data.fd = pidfd;
+            if (::epoll_ctl(this->epollFd, EPOLL_CTL_ADD, pidfd, &event) == 0)
+                return;
+
+            onExit = std::move(this->watches[pidfd].onExit);
+            this->watches.erase(pidfd);
+            this->pidfds.erase(pid);
+            ::close(pidfd);
+        }
+
+        // ENOSYS, EMFILE...: what Child did before the reaper existed
+        std::thread{[pid, onExit = std::move(onExit)] { onExit(waitFor(pid)); }}.detach();
+    }
+
+    std::size_t Reaper::watched() const {
+        auto lock = std::lock_guard<std::mutex>{this->mutex};
+        return this->watches.size();
+    }
+
+    bool Reaper::signal(pid_t pid, int signal, bool group) {
+        // reap() drops the watch under the lock before waiting: until then the
+        // child is at worst a zombie, its pid and process group id can't be reused
+        auto lock = std::lock_guard<std::mutex>{this->mutex};
+        auto it = this->pidfds.find(pid);
+        if (it == this->pidfds.end())
+            return false;
+        if (group && ::kill(-pid, signal) == 0)
+            return true;
+        return pidfdSendSignal(it->second, signal) == 0 || ::kill(pid, signal) == 0;
+    }
+
+    void Reaper::run() {
+        epoll_event events[64];
+        while (!this->stopping.load()) {
+            auto count = ::epoll_wait(this->epollFd, events, 64, -1);
+            for (int i = 0; i < count; i++)
+                if (events[i].data.fd != this->wakeFd)
+                    this->reap(events[i].data.fd);
+        }
+    }
+
+    void Reaper::reap(int pidfd) {
+        auto watch = Watch{};
+        {
+            auto lock = std::lock_guard<std::mutex>{this->mutex};
+            auto it = this->watches.find(pidfd);
+            if (it == this->watches.end())
+                return;
+            watch = std::move(it->second);
+            this->watches.erase(it);
+            this->pidfds.erase(watch.pid);
+            ::epoll_ctl(this->epollFd, EPOLL_CTL_DEL, pidfd, nullptr);
+            ::close(pidfd);
+        }
+
+        // the pidfd is readable once the child terminated, this doesn't block
+        watch.onExit(waitFor(watch.pid));
+    }
+}
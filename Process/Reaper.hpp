@@ -0,0 +1,67 @@
+#ifndef __REAPER_HPP__
+#define __REAPER_HPP__
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include <sys/types.h>
+
+#include "Process.hpp"
+
+namespace process {
+    // a pidfd for the child `pid`, -1 with errno ENOSYS where unsupported
+    int pidfdOpen(pid_t pid);
+
+    // One thread collecting the exit of every watched child: each child gets a
+    // pidfd registered with an epoll instance, and is reaped once it becomes
+    // readable. Without pidfd support (Linux < 5.3, or out of descriptors) a
+    // child falls back to a thread blocking in waitpid().
+    class Reaper {
+        public:
+            // called once, from the reaper thread, after the child was reaped
+            using Callback = std::function<void(Status)>;
+
+            static Reaper& instance();
+
+            // `pid` must be a child of this process that nobody else waits for
+            void watch(pid_t pid, Callback onExit);
+
+            // children currently watched through a pidfd
+            std::size_t watched() const;
+
+            // sends `signal` to a child watched through a pidfd, to its process
+            // group first with `group`; false once it was reaped (or when it's
+            // waited for without a pidfd), its pid may belong to another process by then
+            bool signal(pid_t pid, int signal, bool group = false);
+
+            ~Reaper();
+
+            Reaper(Reaper const&) = delete;
+            Reaper& operator=(Reaper const&) = delete;
+
+        private:
+            struct Watch {
+                pid_t pid;
+                Callback onExit;
+            };
+
+            Reaper();
+
+            void run();
+            void reap(int pidfd);
+
+            int epollFd = -1;
+            int wakeFd = -1;
+            std::atomic<bool> stopping{false};
+
+            mutable std::mutex mutex;
+            std::unordered_map<int, Watch> watches; // by pidfd
+            std::unordered_map<pid_t, int> pidfds;  // of watches, by pid
+
+            std::thread thread;
+    };
+}
+#endif // __REAPER_HPP__
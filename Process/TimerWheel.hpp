@@ -0,0 +1,104 @@
+#ifndef __TIMER_WHEEL_HPP__
+#define __TIMER_WHEEL_HPP__
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace process {
+    // Hierarchical timing wheel: LEVELS wheels of SLOTS slots, a slot of level
+    // n spans SLOTS^n ticks. An entry goes in the lowest level whose span covers
+    // its delay and moves one level down each time the level below wraps, so
+    // scheduling is O(1) and each entry is touched at most LEVELS times.
+    // Entries beyond the last level wait in its farthest slot and are placed
+    // again when it comes around. Not thread-safe.
+    template <typename T> class TimerWheel {
+        public:
+            static constexpr unsigned BITS = 6;
+            static constexpr std::size_t SLOTS = std::size_t{1} << BITS;
+            static constexpr std::size_t LEVELS = 4;
+
+            explicit TimerWheel(std::uint64_t now = 0) : current{now} {}
+
+            // due at `tick`, ticks already passed are due on the next advance()
+            void schedule(std::uint64_t tick, T value) {
+                this->count++;
+                this->place(std::max(tick, this->current + 1), std::move(value));
+            }
+
+            // calls expire(value) for every entry due up to `now`, in tick order
+            template <typename F> void advance(std::uint64_t now, F&& expire) {
+                while (this->current < now && this->count != 0) {
+                    // while the lowest levels are empty only a wrap of the next one can change anything
+                    auto empty = std::size_t{0};
+                    while (empty + 1 < LEVELS && this->perLevel[empty] == 0)
+                        empty++;
+                    this->current = empty == 0 ? this->current + 1 : std::min(now, (this->current | mask(empty)) + 1);
+
+                    auto top = std::size_t{0};
+                    while (top + 1 < LEVELS && (this->current & mask(top + 1)) == 0)
+                        top++;
+                    for (auto level = top; level > 0; level--)
+                        this->cascade(level);
+
+                    auto& slot = this->slots[0][this->current & (SLOTS - 1)];
+                    auto due = std::move(slot);
+                    slot.clear();
+                    this->count -= due.size();
+                    this->perLevel[0] -= due.size();
+                    for (auto& entry : due)
+                        expire(entry.second);
+                }
+                this->current = std::max(this->current, now);
+            }
+
+            // ticks from now to the next slot of level 0 holding entries, or
+            // to the end of level 0's span: when advance() can have work to do
+            std::uint64_t idleTicks() const {
+                for (std::size_t i = 1; i < SLOTS; i++) {
+                    if (!this->slots[0][(this->current + i) & (SLOTS - 1)].empty())
+                        return i;
+                    if (((this->current + i) & (SLOTS - 1)) == 0)
+                        return i;
+                }
+                return SLOTS;
+            }
+
+            std::size_t size() const { return this->count; }
+            bool empty() const { return this->count == 0; }
+
+        private:
+            static constexpr std::uint64_t mask(std::size_t level) {
+                return (std::uint64_t{1} << (BITS * level)) - 1;
+            }
+
+            void place(std::uint64_t tick, T value) {
+                auto delay = tick - this->current;
+                auto level = std::size_t{0};
+                while (level + 1 < LEVELS && delay > mask(level + 1))
+                    level++;
+
+                // beyond the last level: parked in its farthest slot
+                auto at = delay > mask(LEVELS) ? this->current + mask(LEVELS) : tick;
+                this->perLevel[level]++;
+                this->slots[level][(at >> (BITS * level)) & (SLOTS - 1)].emplace_back(tick, std::move(value));
+            }
+
+            void cascade(std::size_t level) {
+                auto& slot = this->slots[level][(this->current >> (BITS * level)) & (SLOTS - 1)];
+                auto entries = std::move(slot);
+                slot.clear();
+                this->perLevel[level] -= entries.size();
+                for (auto& entry : entries)
+                    this->place(std::max(entry.first, this->current), std::move(entry.second));
+            }
+
+            std::vector<std::pair<std::uint64_t, T>> slots[LEVELS][SLOTS];
+            std::size_t perLevel[LEVELS] = {};
+            std::uint64_t current;
+            std::size_t count = 0;
+    };
+}
+#endif // __TIMER_WHEEL_HPP__
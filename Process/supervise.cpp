@@ -0,0 +1,69 @@
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include "Loop.hpp"
+
+// One thread supervising thousands of children: each is awaited by its own
+// coroutine, which gives it a deadline and kills its process group when it
+// overruns. Usage: process_supervise [children]
+namespace {
+    struct Totals {
+        int exited = 0;
+        int killed = 0;
+        int failed = 0;
+    };
+
+    process::Task supervise(int index, Totals& totals) {
+        using namespace std::chrono_literals;
+
+        // one in ten sleeps past its deadline
+        auto seconds = index % 10 == 0 ? "5" : "0." + std::to_string(index % 7);
+        auto child = process::executeUnwatched(process::CommandLine{std::vector<std::string>{"/bin/sleep", seconds}}, "", true);
+        if (child.pid == process::NO_CHILD) {
+            totals.failed++;
+            co_return;
+        }
+
+        auto status = co_await child.exitedWithin(1s);
+        if (status.isStillRunning()) {
+            ::kill(-child.pid, SIGKILL);
+            status = co_await child.exited();
+            totals.killed++;
+            co_return;
+        }
+        totals.exited++;
+    }
+}
+
+int main(int argc, char const* argv[]) {
+    auto children = argc > 1 ? std::atoi(argv[1]) : 2000;
+
+    // one pidfd per child
+    auto limit = rlimit{};
+    if (::getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+        limit.rlim_cur = limit.rlim_max;
+        ::setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    // execute() announces every child
+    std::cout.setstate(std::ios::failbit);
+
+    auto totals = Totals{};
+    auto loop = process::Loop{};
+    for (auto i = 0; i < children; i++)
+        loop.spawn(supervise(i, totals));
+
+    auto start = std::chrono::steady_clock::now();
+    loop.run();
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("%d children in %.2f s on one thread: %d exited, %d killed at their deadline, %d didn't start\n",
+            children, elapsed, totals.exited, totals.killed, totals.failed);
+}
@@ -0,0 +1,110 @@
+#ifndef __LATENCY_HISTOGRAM_HPP__
+#define __LATENCY_HISTOGRAM_HPP__
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Log-linear (HDR-style) buckets over nanoseconds: exact below 32, then 32
+// sub-buckets per power of two, i.e. at most ~3% relative error up to 2^64.
+struct HistogramBuckets {
+    static constexpr int SUB_BITS = 5;
+    static constexpr std::uint64_t SUB_COUNT = std::uint64_t{1} << SUB_BITS;
+    static constexpr std::size_t COUNT = (64 - SUB_BITS + 1) * SUB_COUNT;
+
+    static std::size_t indexOf(std::uint64_t value) {
+        if (value < SUB_COUNT)
+            return static_cast<std::size_t>(value);
+        auto msb = 63 - __builtin_clzll(value);
+        auto shift = msb - SUB_BITS;
+        return static_cast<std::size_t>((shift + 1) * SUB_COUNT + ((value >> shift) - SUB_COUNT));
+    }
+
+    static std::uint64_t lowerBound(std::size_t index) {
+        if (index < SUB_COUNT)
+            return index;
+        auto shift = index / SUB_COUNT - 1;
+        return (SUB_COUNT + index % SUB_COUNT) << shift;
+    }
+
+    // middle of the bucket, what percentiles report
+    static std::uint64_t midpoint(std::size_t index) {
+        if (index < SUB_COUNT)
+            return index;
+        auto shift = index / SUB_COUNT - 1;
+        return lowerBound(index) + ((std::uint64_t{1} << shift) >> 1);
+    }
+};
+
+// plain copy of one or more histograms, what reports are computed from
+struct HistogramSnapshot {
+    std::vector<std::uint64_t> counts = std::vector<std::uint64_t>(HistogramBuckets::COUNT);
+    std::uint64_t count = 0;
+    std::uint64_t sum = 0;
+    std::uint64_t min = std::numeric_limits<std::uint64_t>::max();
+    std::uint64_t max = 0;
+
+    void merge(HistogramSnapshot const& other) {
+        for (std::size_t i = 0; i < HistogramBuckets::COUNT; i++)
+            this->counts[i] += other.counts[i];
+        this->count += other.count;
+        this->sum += other.sum;
+        this->min = std::min(this->min, other.min);
+        this->max = std::max(this->max, other.max);
+    }
+
+    double mean() const { return this->count == 0 ? 0.0 : static_cast<double>(this->sum) / this->count; }
+
+    // value at quantile q in [0, 1], clamped to the observed min/max
+    std::uint64_t percentile(double q) const {
+        if (this->count == 0)
+            return 0;
+        auto rank = static_cast<std::uint64_t>(q * static_cast<double>(this->count - 1)) + 1;
+        auto seen = std::uint64_t{0};
+        for (std::size_t i = 0; i < HistogramBuckets::COUNT; i++) {
+            seen += this->counts[i];
+            if (seen >= rank)
+                return std::clamp(HistogramBuckets::midpoint(i), this->min, this->max);
+        }
+        return this->max;
+    }
+};
+
+// Written by a single thread without locks or read-modify-write atomics,
+// readers on other threads take (slightly stale) snapshots concurrently.
+class LatencyHistogram {
+    public:
+        void record(std::uint64_t ns) {
+            bump(this->counts[HistogramBuckets::indexOf(ns)], 1);
+            bump(this->count, 1);
+            bump(this->sum, ns);
+            if (ns < this->min.load(std::memory_order_relaxed))
+                this->min.store(ns, std::memory_order_relaxed);
+            if (ns > this->max.load(std::memory_order_relaxed))
+                this->max.store(ns, std::memory_order_relaxed);
+        }
+
+        void addTo(HistogramSnapshot& snapshot) const {
+            for (std::size_t i = 0; i < HistogramBuckets::COUNT; i++)
+                snapshot.counts[i] += this->counts[i].load(std::memory_order_relaxed);
+            snapshot.count += this->count.load(std::memory_order_relaxed);
+            snapshot.sum += this->sum.load(std::memory_order_relaxed);
+            snapshot.min = std::min(snapshot.min, this->min.load(std::memory_order_relaxed));
+            snapshot.max = std::max(snapshot.max, this->max.load(std::memory_order_relaxed));
+        }
+
+    private:
+        static void bump(std::atomic<std::uint64_t>& counter, std::uint64_t n) {
+            counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+
+        std::atomic<std::uint64_t> counts[HistogramBuckets::COUNT] = {};
+        std::atomic<std::uint64_t> count{0};
+        std::atomic<std::uint64_t> sum{0};
+        std::atomic<std::uint64_t> min{std::numeric_limits<std::uint64_t>::max()};
+        std::atomic<std::uint64_t> max{0};
+};
+
+#endif //__LATENCY_HISTOGRAM_HPP__
@@ -0,0 +1,179 @@
+#ifndef __PERF_COUNTERS_HPP__
+#define __PERF_COUNTERS_HPP__
+
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "ScopedTimer.hpp"
+
+// One perf_event_open group per thread (cycles, instructions, L1D read misses,
+// LLC misses, branch misses), opened on first use and read with a single
+// grouped read(). Counters the CPU or kernel refuses are left out; when not
+// even cycles can be opened (no PMU in a VM or container, perf_event_paranoid)
+// the group is unavailable and PerfScopedTimer only reports wall-clock time.
+class PerfCounters {
+    public:
+        enum Counter {
+            CYCLES,
+            INSTRUCTIONS,
+            L1D_MISSES,
+            LLC_MISSES,
+            BRANCH_MISSES,
+            COUNT,
+        };
+
+        struct Sample {
+            std::array<std::uint64_t, COUNT> values = {};
+            std::uint64_t enabled = 0;
+            std::uint64_t running = 0;
+        };
+
+        static PerfCounters& local() {
+            thread_local PerfCounters counters;
+            return counters;
+        }
+
+        bool isAvailable() const { return this->leader != -1; }
+        bool has(Counter counter) const { return this->index[counter] != -1; }
+        int error() const { return this->openError; }
+
+        static char const* name(Counter counter) {
+            static char const* const names[COUNT] = {
+                "cycles", "instructions", "L1D misses", "LLC misses", "branch misses"};
+            return names[counter];
+        }
+
+        bool read(Sample& sample) const {
+            // nr, time_enabled, time_running, value per counter
+            std::uint64_t data[3 + COUNT];
+            auto size = static_cast<ssize_t>((3 + this->opened) * sizeof(std::uint64_t));
+            if (!this->isAvailable() || ::read(this->leader, data, sizeof(data)) != size)
+                return false;
+
+            sample.enabled = data[1];
+            sample.running = data[2];
+            for (int counter = 0; counter < COUNT; counter++)
+                sample.values[counter] = this->index[counter] == -1 ? 0 : data[3 + this->index[counter]];
+            return true;
+        }
+
+        PerfCounters(PerfCounters const&) = delete;
+        PerfCounters& operator=(PerfCounters const&) = delete;
+
+        ~PerfCounters() {
+            for (auto fd : this->fds)
+                if (fd != -1)
+                    ::close(fd);
+        }
+
+    private:
+        PerfCounters() {
+            this->fds.fill(-1);
+            this->index.fill(-1);
+
+            auto cache = [](std::uint64_t cache, std::uint64_t result) {
+                return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (result << 16);
+            };
+            this->open(CYCLES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+            if (this->leader == -1)
+                return;
+            this->open(INSTRUCTIONS, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+            this->open(L1D_MISSES, PERF_TYPE_HW_CACHE,
+                    cache(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_RESULT_MISS));
+            this->open(LLC_MISSES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+            this->open(BRANCH_MISSES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+
+            ::ioctl(this->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ::ioctl(this->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+
+        void open(Counter counter, std::uint32_t type, std::uint64_t config) {
+            auto attr = perf_event_attr{};
+            attr.size = sizeof(attr);
+            attr.type = type;
+            attr.config = config;
+            attr.disabled = this->leader == -1 ? 1 : 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+            // this thread, any CPU
+            auto fd = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, this->leader, 0));
+            if (fd == -1) {
+                if (this->leader == -1)
+                    this->openError = errno;
+                return;
+            }
+
+            if (this->leader == -1)
+                this->leader = fd;
+            this->fds[counter] = fd;
+            this->index[counter] = this->opened++;
+        }
+
+        int leader = -1;
+        int opened = 0;
+        int openError = 0;
+        std::array<int, COUNT> fds;
+        std::array<int, COUNT> index; // position of the counter in a group read
+};
+
+// ScopedTimer that also prints counter deltas and IPC for the scope
+template <typename Clock = std::chrono::high_resolution_clock>
+class BasicPerfScopedTimer {
+    private:
+        const char* name;
+        PerfCounters::Sample before;
+        bool counting;
+        typename TimerClock<Clock>::stamp start;
+    public:
+        BasicPerfScopedTimer(const char* name)
+            : name(name), counting(PerfCounters::local().read(before)), start(TimerClock<Clock>::read()) {}
+
+        ~BasicPerfScopedTimer() {
+            auto end = TimerClock<Clock>::readEnd();
+            auto after = PerfCounters::Sample{};
+            auto& counters = PerfCounters::local();
+            auto counted = counting && counters.read(after);
+
+            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+                    TimerClock<Clock>::elapsed(start, end));
+            std::cout << name << " took " << duration.count() << " us";
+
+            if (counted) {
+                // the group was multiplexed with other events part of the time, extrapolate
+                auto enabled = after.enabled - before.enabled;
+                auto running = after.running - before.running;
+                auto scale = running == 0 ? 1.0 : static_cast<double>(enabled) / static_cast<double>(running);
+
+                std::uint64_t delta[PerfCounters::COUNT];
+                for (int counter = 0; counter < PerfCounters::COUNT; counter++) {
+                    delta[counter] = static_cast<std::uint64_t>(
+                            static_cast<double>(after.values[counter] - before.values[counter]) * scale);
+                    if (counters.has(static_cast<PerfCounters::Counter>(counter)))
+                        std::cout << ", " << PerfCounters::name(static_cast<PerfCounters::Counter>(counter))
+                            << " " << delta[counter];
+                }
+                if (counters.has(PerfCounters::INSTRUCTIONS) && delta[PerfCounters::CYCLES] != 0)
+                    std::cout << ", IPC " << static_cast<double>(delta[PerfCounters::INSTRUCTIONS]) /
+                        static_cast<double>(delta[PerfCounters::CYCLES]);
+            } else {
+                std::cout << " (no perf counters: "
+                    << (counters.isAvailable() ? "read failed" : std::strerror(counters.error())) << ")";
+            }
+            std::cout << std::endl;
+        }
+};
+
+using PerfScopedTimer = BasicPerfScopedTimer<>;
+
+#endif //__PERF_COUNTERS_HPP__
@@ -2,21 +2,56 @@
 #define __SCOPED_TIMER_HPP__
 
 #include <chrono>
+#include <cstdint>
 #include <iostream>
 
-class ScopedTimer {
+#include "../Clock/TscClock.hpp"
+
+#define SCOPED_TIMER_CAT_(a, b) a##b
+#define SCOPED_TIMER_CAT(a, b) SCOPED_TIMER_CAT_(a, b)
+
+// how a timer reads its clock and turns two readings into a duration
+template <typename Clock> struct TimerClock {
+    using stamp = typename Clock::time_point;
+
+    static stamp read() { return Clock::now(); }
+    static stamp readEnd() { return Clock::now(); }
+
+    static std::chrono::nanoseconds elapsed(stamp start, stamp end) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start);
+    }
+};
+
+// raw TSC ticks while the scope runs, converted once in the destructor
+template <> struct TimerClock<TscClock> {
+    using stamp = std::uint64_t;
+
+    static stamp read() { return TscClock::ticks(); }
+    static stamp readEnd() { return TscClock::ticksOrdered(); }
+
+    static std::chrono::nanoseconds elapsed(stamp start, stamp end) {
+        return TscClock::toDuration(static_cast<std::int64_t>(end - start));
+    }
+};
+
+template <typename Clock = std::chrono::high_resolution_clock>
+class BasicScopedTimer {
     private:
         const char* name;
-        std::chrono::high_resolution_clock::time_point start;
+        typename TimerClock<Clock>::stamp start;
     public:
-        ScopedTimer(const char* name)
-            : name(name), start(std::chrono::high_resolution_clock::now()) {}
+        BasicScopedTimer(const char* name)
+            : name(name), start(TimerClock<Clock>::read()) {}
 
-        ~ScopedTimer() {
+        ~BasicScopedTimer() {
+            auto end = TimerClock<Clock>::readEnd();
             auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
-                    std::chrono::high_resolution_clock::now() - start);
+                    TimerClock<Clock>::elapsed(start, end));
             std::cout << name << " took " << duration.count() << " us" << std::endl;
         }
 };
 
+using ScopedTimer = BasicScopedTimer<>;
+using TscScopedTimer = BasicScopedTimer<TscClock>;
+
 #endif //__SCOPED_TIMER_HPP__
@@ -0,0 +1,198 @@
+#ifndef __TIMER_REGISTRY_HPP__
+#define __TIMER_REGISTRY_HPP__
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "LatencyHistogram.hpp"
+#include "ScopedTimer.hpp"
+
+// Records the duration of the enclosing scope into the per-thread histogram of
+// `name` instead of printing it, see TimerRegistry::report().
+#define AGGREGATE_SCOPED_TIMER(name) \
+    static std::size_t const SCOPED_TIMER_CAT(scoped_timer_id_, __LINE__) = \
+        TimerRegistry::instance().timerId(name); \
+    auto SCOPED_TIMER_CAT(scoped_timer_, __LINE__) = AggregatingTimer<>{SCOPED_TIMER_CAT(scoped_timer_id_, __LINE__)}
+
+struct TimerStats {
+    std::string name;
+    HistogramSnapshot histogram;
+};
+
+// Every thread owns one histogram per timer name, recording takes no lock.
+// The registry merges them on demand, histograms of exited threads are folded
+// into a per-name total so nothing is lost.
+class TimerRegistry {
+    public:
+        static constexpr std::size_t MAX_TIMERS = 256;
+
+        static TimerRegistry& instance() {
+            static TimerRegistry registry;
+            return registry;
+        }
+
+        // same name, same id; call once per site and keep the result
+        std::size_t timerId(char const* name) {
+            auto lock = std::lock_guard<std::mutex>{this->mutex};
+            for (std::size_t i = 0; i < this->names.size(); i++)
+                if (this->names[i] == name)
+                    return i;
+            if (this->names.size() == MAX_TIMERS) {
+                std::cerr << "TimerRegistry: too many timers, " << name << " is merged into "
+                    << this->names.back() << "\n";
+                return MAX_TIMERS - 1;
+            }
+            this->names.emplace_back(name);
+            this->retired.emplace_back();
+            return this->names.size() - 1;
+        }
+
+        LatencyHistogram& local(std::size_t id) {
+            thread_local ThreadTable table{*this};
+            auto histogram = table.histograms[id].load(std::memory_order_relaxed);
+            if (histogram == nullptr)
+                histogram = table.create(id);
+            return *histogram;
+        }
+
+        std::vector<TimerStats> snapshot() {
+            auto lock = std::lock_guard<std::mutex>{this->mutex};
+            auto stats = std::vector<TimerStats>(this->names.size());
+            for (std::size_t i = 0; i < stats.size(); i++) {
+                stats[i].name = this->names[i];
+                stats[i].histogram.merge(this->retired[i]);
+            }
+            for (auto table : this->tables)
+                for (std::size_t i = 0; i < stats.size(); i++)
+                    if (auto histogram = table->histograms[i].load(std::memory_order_acquire))
+                        histogram->addTo(stats[i].histogram);
+            return stats;
+        }
+
+        // count, min, mean, p50/p90/p99/p99.9 and max per name, in microseconds
+        void report(std::ostream& out) {
+            char line[256];
+            std::snprintf(line, sizeof(line), "%-32s %10s %10s %10s %10s %10s %10s %10s %10s\n",
+                    "timer (us)", "count", "min", "mean", "p50", "p90", "p99", "p99.9", "max");
+            out << line;
+            for (auto const& stats : this->snapshot()) {
+                auto const& h = stats.histogram;
+                if (h.count == 0)
+                    continue;
+                std::snprintf(line, sizeof(line),
+                        "%-32s %10llu %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f\n",
+                        stats.name.c_str(), static_cast<unsigned long long>(h.count), h.min / 1e3,
+                        h.mean() / 1e3, h.percentile(0.5) / 1e3, h.percentile(0.9) / 1e3,
+                        h.percentile(0.99) / 1e3, h.percentile(0.999) / 1e3, h.max / 1e3);
+                out << line;
+            }
+            out.flush();
+        }
+
+        // reports every `interval` from a background thread until stopPeriodicReport()
+        void startPeriodicReport(std::chrono::milliseconds interval, std::ostream& out = std::cout) {
+            this->stopPeriodicReport();
+            auto lock = std::lock_guard<std::mutex>{this->reportMutex};
+            this->reporting = true;
+            this->reporter = std::thread{[this, interval, &out] {
+                auto lock = std::unique_lock<std::mutex>{this->reportMutex};
+                while (!this->reportCondition.wait_for(lock, interval, [this] { return !this->reporting; }))
+                    this->report(out);
+            }};
+        }
+
+        void stopPeriodicReport() {
+            {
+                auto lock = std::lock_guard<std::mutex>{this->reportMutex};
+                this->reporting = false;
+            }
+            this->reportCondition.notify_all();
+            if (this->reporter.joinable())
+                this->reporter.join();
+        }
+
+        // reports once more when the registry is destroyed at exit
+        void reportAtExit(std::ostream& out = std::cout) {
+            auto lock = std::lock_guard<std::mutex>{this->mutex};
+            this->exitReport = &out;
+        }
+
+        ~TimerRegistry() {
+            this->stopPeriodicReport();
+            if (this->exitReport != nullptr)
+                this->report(*this->exitReport);
+        }
+
+    private:
+        struct ThreadTable {
+            TimerRegistry& registry;
+            std::array<std::atomic<LatencyHistogram*>, MAX_TIMERS> histograms = {};
+            std::vector<std::unique_ptr<LatencyHistogram>> owned;
+
+            explicit ThreadTable(TimerRegistry& registry) : registry{registry} {
+                auto lock = std::lock_guard<std::mutex>{registry.mutex};
+                registry.tables.push_back(this);
+            }
+
+            LatencyHistogram* create(std::size_t id) {
+                auto lock = std::lock_guard<std::mutex>{this->registry.mutex};
+                this->owned.push_back(std::make_unique<LatencyHistogram>());
+                this->histograms[id].store(this->owned.back().get(), std::memory_order_release);
+                return this->owned.back().get();
+            }
+
+            ~ThreadTable() {
+                auto lock = std::lock_guard<std::mutex>{this->registry.mutex};
+                for (std::size_t i = 0; i < this->registry.retired.size(); i++)
+                    if (auto histogram = this->histograms[i].load(std::memory_order_relaxed)) {
+                        auto snapshot = HistogramSnapshot{};
+                        histogram->addTo(snapshot);
+                        this->registry.retired[i].merge(snapshot);
+                    }
+                auto& tables = this->registry.tables;
+                tables.erase(std::find(tables.begin(), tables.end(), this));
+            }
+        };
+
+        TimerRegistry() = default;
+
+        std::mutex mutex;
+        std::vector<std::string> names;
+        std::vector<HistogramSnapshot> retired;
+        std::vector<ThreadTable*> tables;
+        std::ostream* exitReport = nullptr;
+
+        std::mutex reportMutex;
+        std::condition_variable reportCondition;
+        std::thread reporter;
+        bool reporting = false;
+};
+
+// like ScopedTimer but records into the registry, TSC ticks by default
+template <typename Clock = TscClock>
+class AggregatingTimer {
+    private:
+        LatencyHistogram& histogram;
+        typename TimerClock<Clock>::stamp start;
+    public:
+        explicit AggregatingTimer(std::size_t id)
+            : histogram(TimerRegistry::instance().local(id)), start(TimerClock<Clock>::read()) {}
+
+        AggregatingTimer(AggregatingTimer const&) = delete;
+        AggregatingTimer& operator=(AggregatingTimer const&) = delete;
+
+        ~AggregatingTimer() {
+            auto end = TimerClock<Clock>::readEnd();
+            histogram.record(static_cast<std::uint64_t>(TimerClock<Clock>::elapsed(start, end).count()));
+        }
+};
+
+#endif //__TIMER_REGISTRY_HPP__
@@ -0,0 +1,247 @@
+#ifndef __TRACE_HPP__
+#define __TRACE_HPP__
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "ScopedTimer.hpp"
+
+// Emits a span for the enclosing scope, nested scopes nest in the viewer.
+#define TRACE_SCOPE(name) auto SCOPED_TIMER_CAT(trace_scope_, __LINE__) = TraceScope{name}
+
+// Span recorder writing Chrome Trace Event JSON (chrome://tracing, ui.perfetto.dev).
+// Each thread records into its own fixed-size ring, allocated once on its first
+// span; when full the oldest spans are overwritten. Recording is off until
+// enable(), and costs one relaxed load when off. Rings of exited threads are
+// kept until the next export, at most setRetainedThreads() of them.
+class Trace {
+    public:
+        struct Event {
+            char const* name; // must outlive the trace, string literals in practice
+            std::uint64_t start;
+            std::uint64_t end;
+        };
+
+        static void enable() { s_enabled.store(true, std::memory_order_relaxed); }
+        static void disable() { s_enabled.store(false, std::memory_order_relaxed); }
+        static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+        // ring size (rounded up to a power of two) of threads that have not traced yet
+        static void setBufferCapacity(std::size_t events) {
+            auto capacity = std::size_t{2};
+            while (capacity < events)
+                capacity <<= 1;
+            s_capacity.store(capacity, std::memory_order_relaxed);
+        }
+
+        // rings of exited threads kept for export, the oldest are dropped beyond that
+        static void setRetainedThreads(std::size_t threads) {
+            auto lock = std::lock_guard<std::mutex>{s_mutex};
+            s_retained = threads;
+            trimRetired();
+        }
+
+        // shown instead of the thread id, e.g. "monitor" or "state machine"
+        static void setThreadName(char const* name) {
+            auto& buffer = local();
+            auto lock = std::lock_guard<std::mutex>{s_mutex};
+            buffer.name = name;
+        }
+
+        static void record(char const* name, std::uint64_t start, std::uint64_t end) {
+            auto& buffer = local();
+            auto head = buffer.head.load(std::memory_order_relaxed);
+            auto& slot = buffer.slots[head & buffer.mask];
+
+            // seqlock: odd while the slot is being written, 2 * (index + 1) once it holds span `index`
+            slot.sequence.store(2 * head + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            slot.name.store(name, std::memory_order_relaxed);
+            slot.start.store(start, std::memory_order_relaxed);
+            slot.end.store(end, std::memory_order_relaxed);
+            slot.sequence.store(2 * head + 2, std::memory_order_release);
+            buffer.head.store(head + 1, std::memory_order_release);
+        }
+
+        // spans of all threads, running or exited, that are still in their ring;
+        // rings of exited threads are released once written
+        static void writeChromeTrace(std::ostream& out) {
+            auto lock = std::lock_guard<std::mutex>{s_mutex};
+            auto pid = ::getpid();
+            auto first = true;
+            auto separator = [&out, &first] {
+                out << (first ? "\n" : ",\n");
+                first = false;
+            };
+
+            auto flags = out.flags();
+            auto precision = out.precision();
+            out << std::fixed << std::setprecision(3);
+
+            out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+            for (auto const& buffer : buffers()) {
+                if (!buffer->name.empty()) {
+                    separator();
+                    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":"
+                        << buffer->tid << ",\"args\":{\"name\":\"";
+                    writeEscaped(out, buffer->name.c_str());
+                    out << "\"}}";
+                }
+
+                for (auto const& event : buffer->copy()) {
+                    separator();
+                    out << "{\"name\":\"";
+                    writeEscaped(out, event.name);
+                    out << "\",\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":" << buffer->tid
+                        << ",\"ts\":" << toMicroseconds(event.start - s_origin)
+                        << ",\"dur\":" << toMicroseconds(event.end - event.start) << "}";
+                }
+            }
+            out << "\n]}\n";
+
+            out.flags(flags);
+            out.precision(precision);
+
+            auto& all = buffers();
+            all.erase(std::remove_if(all.begin(), all.end(), [](auto const& b) { return b->exited; }), all.end());
+        }
+
+        static bool writeChromeTrace(std::string const& path) {
+            auto out = std::ofstream{path};
+            writeChromeTrace(out);
+            return static_cast<bool>(out);
+        }
+
+    private:
+        struct Slot {
+            std::atomic<std::uint64_t> sequence{0};
+            std::atomic<char const*> name{nullptr};
+            std::atomic<std::uint64_t> start{0};
+            std::atomic<std::uint64_t> end{0};
+        };
+
+        struct Buffer {
+            std::unique_ptr<Slot[]> slots;
+            std::size_t mask;
+            std::atomic<std::uint64_t> head{0};
+            long tid;
+            std::string name;
+            bool exited = false; // under s_mutex
+
+            explicit Buffer(std::size_t capacity)
+                : slots{new Slot[capacity]}, mask{capacity - 1}, tid{::syscall(SYS_gettid)} {}
+
+            // spans still in the ring; a slot rewritten while it is read is skipped
+            std::vector<Event> copy() const {
+                auto end = this->head.load(std::memory_order_acquire);
+                auto begin = end > this->mask + 1 ? end - this->mask - 1 : 0;
+                auto events = std::vector<Event>{};
+                for (auto i = begin; i < end; i++) {
+                    auto const& slot = this->slots[i & this->mask];
+                    auto sequence = slot.sequence.load(std::memory_order_acquire);
+                    if (sequence != 2 * i + 2)
+                        continue;
+                    auto event = Event{slot.name.load(std::memory_order_relaxed),
+                        slot.start.load(std::memory_order_relaxed), slot.end.load(std::memory_order_relaxed)};
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    if (slot.sequence.load(std::memory_order_relaxed) == sequence)
+                        events.push_back(event);
+                }
+                return events;
+            }
+        };
+
+        // marks the ring of an exiting thread, it is released by the next export
+        struct Owner {
+            Buffer* buffer;
+
+            Owner() {
+                auto lock = std::lock_guard<std::mutex>{s_mutex};
+                buffers().push_back(std::make_unique<Buffer>(s_capacity.load(std::memory_order_relaxed)));
+                this->buffer = buffers().back().get();
+            }
+
+            ~Owner() {
+                auto lock = std::lock_guard<std::mutex>{s_mutex};
+                this->buffer->exited = true;
+                trimRetired();
+            }
+        };
+
+        static Buffer& local() {
+            thread_local Owner owner;
+            return *owner.buffer;
+        }
+
+        // under s_mutex
+        static void trimRetired() {
+            auto& all = buffers();
+            auto retired = static_cast<std::size_t>(
+                    std::count_if(all.begin(), all.end(), [](auto const& b) { return b->exited; }));
+            for (auto it = all.begin(); it != all.end() && retired > s_retained;) {
+                if ((*it)->exited) {
+                    it = all.erase(it);
+                    retired--;
+                } else {
+                    ++it;
+                }
+            }
+        }
+
+        static std::vector<std::unique_ptr<Buffer>>& buffers() {
+            static std::vector<std::unique_ptr<Buffer>> all;
+            return all;
+        }
+
+        static double toMicroseconds(std::uint64_t ticks) {
+            return static_cast<double>(TscClock::toDuration(static_cast<std::int64_t>(ticks)).count()) / 1e3;
+        }
+
+        static void writeEscaped(std::ostream& out, char const* s) {
+            for (; *s != '\0'; s++) {
+                if (*s == '"' || *s == '\\')
+                    out << '\\' << *s;
+                else if (static_cast<unsigned char>(*s) < 0x20)
+                    out << ' ';
+                else
+                    out << *s;
+            }
+        }
+
+        static inline std::atomic<bool> s_enabled{false};
+        static inline std::atomic<std::size_t> s_capacity{16384};
+        static inline std::size_t s_retained = 64;
+        static inline std::mutex s_mutex;
+        static inline std::uint64_t const s_origin = TscClock::ticks();
+};
+
+// span for the lifetime of the object, nothing is recorded while tracing is off
+class TraceScope {
+    private:
+        char const* name;
+        std::uint64_t start;
+    public:
+        explicit TraceScope(char const* name)
+            : name(Trace::isEnabled() ? name : nullptr), start(this->name ? TscClock::ticks() : 0) {}
+
+        TraceScope(TraceScope const&) = delete;
+        TraceScope& operator=(TraceScope const&) = delete;
+
+        ~TraceScope() {
+            if (name != nullptr)
+                Trace::record(name, start, TscClock::ticksOrdered());
+        }
+};
+
+#endif //__TRACE_HPP__
@@ -0,0 +1,44 @@
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include "TimerRegistry.hpp"
+
+double work(int n) {
+    AGGREGATE_SCOPED_TIMER("work");
+    auto x = 0.0;
+    for (int i = 0; i < n; i++)
+        x += std::sqrt(i);
+    return x;
+}
+
+int main() {
+    TimerRegistry::instance().reportAtExit();
+    TimerRegistry::instance().startPeriodicReport(std::chrono::milliseconds(500));
+
+    // one accumulator per thread, combined after join()
+    auto sums = std::vector<double>(4);
+    auto threads = std::vector<std::thread>{};
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([t, &sums] {
+            AGGREGATE_SCOPED_TIMER("thread");
+            auto sum = 0.0;
+            for (int i = 0; i < 200000; i++)
+                sum += work((i % 100) * (t + 1));
+            sums[t] = sum;
+        });
+    }
+    for (auto& t : threads)
+        t.join();
+
+    auto sink = 0.0;
+    for (auto sum : sums)
+        sink += sum;
+
+    {
+        AGGREGATE_SCOPED_TIMER("sleep");
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    return sink < 0;
+}
@@ -0,0 +1,36 @@
+#include <thread>
+#include <vector>
+
+#include "Trace.hpp"
+
+void step(int i) {
+    TRACE_SCOPE("step");
+    if (i % 10 == 0) {
+        TRACE_SCOPE("checkpoint");
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+}
+
+int main() {
+    Trace::enable();
+    Trace::setThreadName("main");
+
+    auto threads = std::vector<std::thread>{};
+    for (int t = 0; t < 3; t++) {
+        threads.emplace_back([] {
+            Trace::setThreadName("worker");
+            TRACE_SCOPE("worker");
+            for (int i = 0; i < 100; i++)
+                step(i);
+        });
+    }
+    {
+        TRACE_SCOPE("join");
+        for (auto& t : threads)
+            t.join();
+    }
+
+    Trace::disable();
+    return Trace::writeChromeTrace("trace.json") ? 0 : 1;
+}
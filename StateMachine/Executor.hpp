@@ -0,0 +1,494 @@
+#ifndef __EXECUTOR_HPP__
+#define __EXECUTOR_HPP__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "StateMachine1.hpp"
+#include "TransitionTrace.hpp"
+
+namespace executor {
+  // a transition sent to a machine, linked in its inbox
+  struct Event {
+    Transition transition;
+    Event* next;
+  };
+
+  // Lock-free multi-producer list: push() is one CAS, takeAll() empties it
+  // with one exchange and hands back the oldest first. Nothing is ever popped
+  // one at a time, so there's no ABA. `T` has a `T* next`. Sequentially
+  // consistent, a push and a later empty() check on another thread order.
+  template <typename T> class List {
+  public:
+    void push(T* item) {
+      auto head = this->head.load(std::memory_order_relaxed);
+      do
+        item->next = head;
+      while (!this->head.compare_exchange_weak(head, item, std::memory_order_seq_cst, std::memory_order_relaxed));
+    }
+
+    T* takeAll() {
+      // newest first as pushed, reversed
+      auto item = this->head.exchange(nullptr, std::memory_order_acquire);
+      T* oldest = nullptr;
+      while (item != nullptr) {
+        auto next = item->next;
+        item->next = oldest;
+        oldest = item;
+        item = next;
+      }
+      return oldest;
+    }
+
+    bool empty() const { return this->head.load(std::memory_order_seq_cst) == nullptr; }
+
+  private:
+    std::atomic<T*> head{nullptr};
+  };
+
+  // Chase-Lev work-stealing deque: the owner pushes and takes at the bottom,
+  // thieves steal the oldest at the top. The owner grows it, replaced
+  // buffers are kept until the deque goes since a thief may still read one.
+  template <typename T> class WorkDeque {
+  public:
+    WorkDeque() : buffer{new Buffer{INITIAL_CAPACITY}} { this->buffers.emplace_back(this->buffer.load()); }
+
+    void push(T* item) {
+      auto bottom = this->bottom.load(std::memory_order_relaxed);
+      auto top = this->top.load(std::memory_order_acquire);
+      auto buffer = this->buffer.load(std::memory_order_relaxed);
+      if (bottom - top > buffer->mask)
+        buffer = this->grow(buffer, top, bottom);
+      buffer->at(bottom).store(item, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      this->bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    T* take() {
+      auto bottom = this->bottom.load(std::memory_order_relaxed) - 1;
+      auto buffer = this->buffer.load(std::memory_order_relaxed);
+      this->bottom.store(bottom, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      auto top = this->top.load(std::memory_order_relaxed);
+      if (top > bottom) {
+        this->bottom.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+      }
+      auto item = buffer->at(bottom).load(std::memory_order_relaxed);
+      if (top == bottom) {
+        // the last one, a thief may be after it too
+        if (!this->top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+          item = nullptr;
+        this->bottom.store(bottom + 1, std::memory_order_relaxed);
+      }
+      return item;
+    }
+
+    // nullptr when empty or when another thief won
+    T* steal() {
+      auto top = this->top.load(std::memory_order_acquire);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      auto bottom = this->bottom.load(std::memory_order_acquire);
+      if (top >= bottom)
+        return nullptr;
+      auto item = this->buffer.load(std::memory_order_acquire)->at(top).load(std::memory_order_relaxed);
+      if (!this->top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return nullptr;
+      return item;
+    }
+
+    std::int64_t size() const {
+      auto size = this->bottom.load(std::memory_order_relaxed) - this->top.load(std::memory_order_relaxed);
+      return size > 0 ? size : 0;
+    }
+
+  private:
+    static constexpr std::int64_t INITIAL_CAPACITY = 1024;
+
+    struct Buffer {
+      explicit Buffer(std::int64_t capacity) : mask{capacity - 1}, items{new std::atomic<T*>[capacity]} {}
+
+      std::atomic<T*>& at(std::int64_t i) { return this->items[i & this->mask]; }
+
+      std::int64_t mask;
+      std::unique_ptr<std::atomic<T*>[]> items;
+    };
+
+    Buffer* grow(Buffer* buffer, std::int64_t top, std::int64_t bottom) {
+      auto bigger = new Buffer{(buffer->mask + 1) * 2};
+      for (auto i = top; i < bottom; i++)
+        bigger->at(i).store(buffer->at(i).load(std::memory_order_relaxed), std::memory_order_relaxed);
+      this->buffers.emplace_back(bigger);
+      this->buffer.store(bigger, std::memory_order_release);
+      return bigger;
+    }
+
+    alignas(64) std::atomic<std::int64_t> top{0};
+    alignas(64) std::atomic<std::int64_t> bottom{0};
+    std::atomic<Buffer*> buffer;
+    std::vector<std::unique_ptr<Buffer>> buffers; // owner only
+  };
+} // namespace executor
+
+// StateMachine1's Machines driven by transition events on a pool of worker
+// threads. post() puts an event in the machine's inbox, a lock-free list;
+// the first event of an idle machine also makes it runnable. A runnable
+// machine is in exactly one queue, the one of the worker that runs it next,
+// so it never runs on two threads at once. Each worker has:
+//  - a work-stealing deque of machines made runnable on that worker,
+//  - an injection list of machines made runnable from elsewhere, for which
+//    it's home; machines are sharded round-robin unless add() says where,
+//  - counters, see Counters.
+// A worker takes from its deque, then its injection list, then steals from
+// a random other worker's deque or injection list, then sleeps.
+// Running a machine handles up to BUDGET events: the state moves along
+// Transitions1, the step goes to the transition trace (see
+// TransitionTrace.hpp, machines by add()'s id), the action of the new state
+// runs and its Transition is the machine's next event, as main() does it.
+// A machine that has more events goes back to the end of its worker's
+// injection list, every 61st turn the worker takes that list first, so
+// machines that always have events can't starve the others.
+// add() isn't thread-safe and mustn't run while events are being posted.
+class Executor {
+public:
+  // handled by a machine before another gets a turn
+  static constexpr std::size_t BUDGET = 64;
+
+  // what a worker did, a snapshot
+  struct Counters {
+    std::uint64_t events = 0;        // handled
+    std::uint64_t runs = 0;          // machines taken and run
+    std::uint64_t steals = 0;        // machines taken from another worker
+    std::uint64_t stealAttempts = 0; // tries at another worker, successful or not
+    std::uint64_t depth = 0;         // of the deque, when it last took a machine
+    std::uint64_t maxDepth = 0;
+
+    double stealRate() const { return this->runs == 0 ? 0 : static_cast<double>(this->steals) / this->runs; }
+  };
+
+  explicit Executor(std::size_t workers = std::thread::hardware_concurrency()) {
+    if (workers == 0)
+      workers = 1;
+    for (std::size_t i = 0; i < workers; i++)
+      this->workers.emplace_back(new Worker{this});
+    for (std::size_t i = 0; i < workers; i++)
+      this->workers[i]->thread = std::thread{[this, i] { this->work(*this->workers[i]); }};
+  }
+
+  ~Executor() {
+    {
+      auto lock = std::lock_guard<std::mutex>{this->parkLock};
+      this->stopping.store(true, std::memory_order_release);
+    }
+    this->parked.notify_all();
+    for (auto& worker : this->workers)
+      worker->thread.join();
+    for (auto& slot : this->slots) {
+      for (auto event = slot.inbox.takeAll(); event != nullptr;) {
+        auto next = event->next;
+        delete event;
+        event = next;
+      }
+    }
+  }
+
+  Executor(Executor const&) = delete;
+  Executor& operator=(Executor const&) = delete;
+
+  // a machine as it is, idle until it gets an event; `home` is the worker
+  // whose injection list it joins when posted to from outside
+  std::size_t add(Machine const& machine = Machine{}, std::size_t home = NO_HOME) {
+    auto id = this->slots.size();
+    this->slots.emplace_back();
+    auto& slot = this->slots.back();
+    slot.machine = machine;
+    slot.home = (home == NO_HOME ? id : home) % this->workers.size();
+    slot.id = static_cast<std::uint32_t>(id);
+    return id;
+  }
+
+  // from any thread, actions included
+  void post(std::size_t machine, Transition transition) {
+    this->pending.fetch_add(1, std::memory_order_relaxed);
+    auto& slot = this->slots[machine];
+    slot.inbox.push(new executor::Event{transition, nullptr});
+    if (!slot.scheduled.exchange(true, std::memory_order_seq_cst))
+      this->schedule(slot);
+  }
+
+  // until every event posted was handled, events posted meanwhile included
+  void wait() {
+    auto lock = std::unique_lock<std::mutex>{this->drainedLock};
+    this->drained.wait(lock, [this] { return this->pending.load(std::memory_order_acquire) == 0; });
+  }
+
+  // read them after wait() for a consistent view
+  State state(std::size_t machine) const { return this->slots[machine].machine.state; }
+
+  int loop(std::size_t machine) const { return this->slots[machine].machine.loop; }
+
+  std::size_t size() const { return this->slots.size(); }
+
+  std::size_t workerCount() const { return this->workers.size(); }
+
+  Counters counters(std::size_t worker) const {
+    auto const& counters = this->workers[worker]->counters;
+    auto snapshot = Counters{};
+    snapshot.events = counters.events.load(std::memory_order_relaxed);
+    snapshot.runs = counters.runs.load(std::memory_order_relaxed);
+    snapshot.steals = counters.steals.load(std::memory_order_relaxed);
+    snapshot.stealAttempts = counters.stealAttempts.load(std::memory_order_relaxed);
+    snapshot.depth = counters.depth.load(std::memory_order_relaxed);
+    snapshot.maxDepth = counters.maxDepth.load(std::memory_order_relaxed);
+    return snapshot;
+  }
+
+private:
+  static constexpr std::size_t NO_HOME = static_cast<std::size_t>(-1);
+
+  // the worker takes its injection list first every FAIRNESS turns
+  static constexpr std::uint64_t FAIRNESS = 61;
+
+  struct alignas(64) Slot {
+    Machine machine;
+    executor::List<executor::Event> inbox;
+    std::atomic<bool> scheduled{false}; // runnable or running
+    Slot* next = nullptr;               // in an injection list
+    std::size_t home = 0;
+    std::uint32_t id = 0; // add()'s, in the transition trace
+  };
+
+  // written by their worker only
+  struct Counter {
+    std::atomic<std::uint64_t> value{0};
+
+    void add(std::uint64_t n) { this->value.store(this->value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+
+    std::uint64_t load(std::memory_order order) const { return this->value.load(order); }
+
+    void store(std::uint64_t n, std::memory_order order) { this->value.store(n, order); }
+  };
+
+  struct alignas(64) Worker {
+    explicit Worker(Executor* executor) : executor{executor} {}
+
+    Executor* executor;
+    executor::WorkDeque<Slot> deque;
+    executor::List<Slot> injected;
+    std::thread thread;
+    std::uint64_t turns = 0;
+    std::uint64_t random = 0;
+    struct {
+      Counter events;
+      Counter runs;
+      Counter steals;
+      Counter stealAttempts;
+      Counter depth;
+      Counter maxDepth;
+    } counters;
+  };
+
+  static Worker*& current() {
+    static thread_local Worker* worker = nullptr;
+    return worker;
+  }
+
+  // runnable on this worker if it's one of ours, at home otherwise
+  void schedule(Slot& slot) {
+    auto worker = current();
+    if (worker != nullptr && worker->executor == this)
+      worker->deque.push(&slot);
+    else
+      this->workers[slot.home]->injected.push(&slot);
+    this->wake();
+  }
+
+  void wake() {
+    // pairs with park(): either the sleeper sees the work, or this sees the sleeper
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (this->sleeping.load(std::memory_order_seq_cst) == 0)
+      return;
+    {
+      auto lock = std::lock_guard<std::mutex>{this->parkLock};
+      this->wakeups++;
+    }
+    this->parked.notify_one();
+  }
+
+  void park() {
+    auto lock = std::unique_lock<std::mutex>{this->parkLock};
+    this->sleeping.fetch_add(1, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!this->stopping.load(std::memory_order_relaxed) && !this->anyWork()) {
+      auto seen = this->wakeups;
+      this->parked.wait(lock, [this, seen] { return this->wakeups != seen || this->stopping.load(std::memory_order_relaxed); });
+    }
+    this->sleeping.fetch_sub(1, std::memory_order_seq_cst);
+  }
+
+  bool anyWork() const {
+    for (auto& worker : this->workers)
+      if (worker->deque.size() != 0 || !worker->injected.empty())
+        return true;
+    return false;
+  }
+
+  // an injection list into the deque, returns the oldest to run now; thieves
+  // steal the next oldest
+  Slot* takeInjected(Worker& worker, executor::List<Slot>& list) {
+    auto first = list.takeAll();
+    if (first == nullptr)
+      return nullptr;
+    for (auto slot = first->next; slot != nullptr;) {
+      auto next = slot->next;
+      worker.deque.push(slot);
+      slot = next;
+    }
+    return first;
+  }
+
+  Slot* steal(Worker& worker) {
+    auto count = this->workers.size();
+    if (count == 1)
+      return nullptr;
+    for (std::size_t attempt = 0; attempt < count * 2; attempt++) {
+      // xorshift: a victim other than this worker
+      worker.random ^= worker.random << 13;
+      worker.random ^= worker.random >> 7;
+      worker.random ^= worker.random << 17;
+      auto& victim = *this->workers[worker.random % count];
+      if (&victim == &worker)
+        continue;
+      worker.counters.stealAttempts.add(1);
+      auto slot = victim.deque.steal();
+      if (slot == nullptr)
+        slot = this->takeInjected(worker, victim.injected);
+      if (slot != nullptr) {
+        worker.counters.steals.add(1);
+        return slot;
+      }
+    }
+    return nullptr;
+  }
+
+  Slot* next(Worker& worker) {
+    Slot* slot = nullptr;
+    if (++worker.turns % FAIRNESS == 0)
+      slot = this->takeInjected(worker, worker.injected);
+    if (slot == nullptr)
+      slot = worker.deque.take();
+    if (slot == nullptr)
+      slot = this->takeInjected(worker, worker.injected);
+    if (slot == nullptr)
+      slot = this->steal(worker);
+    return slot;
+  }
+
+  void work(Worker& worker) {
+    current() = &worker;
+    worker.random = reinterpret_cast<std::uintptr_t>(&worker) | 1;
+    while (!this->stopping.load(std::memory_order_acquire)) {
+      auto slot = this->next(worker);
+      if (slot == nullptr) {
+        this->park();
+        continue;
+      }
+      auto depth = static_cast<std::uint64_t>(worker.deque.size());
+      worker.counters.depth.store(depth, std::memory_order_relaxed);
+      if (depth > worker.counters.maxDepth.load(std::memory_order_relaxed))
+        worker.counters.maxDepth.store(depth, std::memory_order_relaxed);
+      worker.counters.runs.add(1);
+      this->run(worker, *slot);
+    }
+  }
+
+  // the action of the state it lands in, its Transition is the next event;
+  // the step is recorded in the transition trace
+  static bool handle(std::uint32_t id, Machine& machine, Transition& transition) {
+    // ended machines drop their events
+    if (machine.state == State::S_END_MACHINE)
+      return false;
+    auto source = machine.state;
+    machine.state = Transitions1::next(source, transition);
+    transitionTrace::record(id, source, transition, machine.state);
+    switch (machine.state) {
+    case State::S_END_MACHINE:
+      return false;
+    case State::S_SAMPLE_0:
+      transition = executeActionSample0(machine);
+      break;
+    case State::S_SAMPLE_1:
+      transition = executeActionSample1(machine);
+      break;
+    case State::S_FAILURE:
+      transition = executeActionFailure(machine);
+      break;
+    case State::S_START_MACHINE:
+    default:
+      assert(false);
+      return false;
+    }
+    machine.transition = transition;
+    return true;
+  }
+
+  void run(Worker& worker, Slot& slot) {
+    auto handled = std::uint64_t{0};
+    auto posted = std::uint64_t{0};
+    while (handled < BUDGET) {
+      auto event = slot.inbox.takeAll();
+      if (event == nullptr)
+        break;
+      while (event != nullptr) {
+        auto next = event->next;
+        handled++;
+        // the event goes back in the inbox as the next one
+        if (handle(slot.id, slot.machine, event->transition)) {
+          slot.inbox.push(event);
+          posted++;
+        } else {
+          delete event;
+        }
+        event = next;
+      }
+    }
+    worker.counters.events.add(handled);
+
+    // what was posted to itself is counted with what was handled, pending
+    // only reaches 0 once both are done
+    if (this->pending.fetch_sub(handled - posted, std::memory_order_acq_rel) == handled - posted) {
+      {
+        auto lock = std::lock_guard<std::mutex>{this->drainedLock};
+      }
+      this->drained.notify_all();
+    }
+
+    slot.scheduled.store(false, std::memory_order_seq_cst);
+    if (!slot.inbox.empty() && !slot.scheduled.exchange(true, std::memory_order_seq_cst)) {
+      // more to do: after the machines already waiting here
+      worker.injected.push(&slot);
+      this->wake();
+    }
+  }
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::deque<Slot> slots;
+  std::atomic<std::uint64_t> pending{0}; // events posted, not handled yet
+
+  std::mutex parkLock;
+  std::condition_variable parked;
+  std::uint64_t wakeups = 0;         // under parkLock
+  std::atomic<bool> stopping{false}; // set under parkLock
+  std::atomic<int> sleeping{0};
+
+  std::mutex drainedLock;
+  std::condition_variable drained;
+};
+
+#endif //__EXECUTOR_HPP__
@@ -0,0 +1,203 @@
+#ifndef __MACHINE_BATCH_HPP__
+#define __MACHINE_BATCH_HPP__
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "StateMachine1.hpp"
+
+namespace machineBatch {
+  static constexpr std::size_t TABLE_SIZE = STATE_COUNT * TRANSITION_COUNT;
+
+  // Transitions1 by index; pairs it doesn't define lead to its Fallback, but
+  // S_END_MACHINE has no way out and its machines stay there
+  constexpr std::array<std::uint8_t, TABLE_SIZE> destinations() {
+    auto table = std::array<std::uint8_t, TABLE_SIZE>{};
+    for (std::size_t state = 0; state < STATE_COUNT; state++) {
+      for (std::size_t transition = 0; transition < TRANSITION_COUNT; transition++) {
+        auto destination = Transitions1::FALLBACK;
+        if (State(state) == State::S_END_MACHINE)
+          destination = State::S_END_MACHINE;
+        else if (Transitions1::defined(State(state), Transition(transition)))
+          destination = Transitions1::next(State(state), Transition(transition));
+        table[state * TRANSITION_COUNT + transition] = static_cast<std::uint8_t>(destination);
+      }
+    }
+    return table;
+  }
+
+  template <std::size_t N> constexpr std::uint8_t mostCommon(std::array<std::uint8_t, N> const& values) {
+    auto counts = std::array<std::size_t, 256>{};
+    auto common = values[0];
+    for (auto value : values)
+      if (++counts[value] > counts[common])
+        common = value;
+    return common;
+  }
+} // namespace machineBatch
+
+// Many Machines stepped together, stored as structure-of-arrays: one array of
+// states, one of pending transitions, one of loops. A tick goes through them
+// LANES machines at a time, a Block in vector registers:
+//  - every machine of the block takes its pending transition at once, compared
+//    against each entry of the dense table: no per-machine branch, no gather,
+//    plain SSE2 does,
+//  - each action then runs over the whole block, masked to the machines that
+//    landed in its state. An action without a batch form runs machine by
+//    machine on a Machine, only in blocks holding its state, see
+//    executeActionFailure.
+// The last block is padded with ended machines.
+// GCC/Clang vector extensions: SSE2 on x86-64, NEON on ARM, scalar elsewhere.
+class MachineBatch {
+public:
+  static constexpr std::size_t LANES = 16;
+
+  // a machine as it is, Machine{} is a new one
+  std::size_t add(Machine const& machine = Machine{}) {
+    if (this->count % LANES == 0) {
+      this->states.resize(this->states.size() + LANES, static_cast<std::uint8_t>(State::S_END_MACHINE));
+      this->transitions.resize(this->transitions.size() + LANES, static_cast<std::uint8_t>(Transition::T_DEFAULT));
+      this->loops.resize(this->loops.size() + LANES, 0);
+    }
+    auto added = this->count++;
+    this->states[added] = static_cast<std::uint8_t>(machine.state);
+    this->transitions[added] = static_cast<std::uint8_t>(machine.transition);
+    this->loops[slot(added)] = machine.loop;
+    return added;
+  }
+
+  std::size_t size() const { return this->count; }
+
+  State state(std::size_t machine) const { return static_cast<State>(this->states[machine]); }
+
+  Transition transition(std::size_t machine) const { return static_cast<Transition>(this->transitions[machine]); }
+
+  int loop(std::size_t machine) const { return this->loops[slot(machine)]; }
+
+  // machines not in S_END_MACHINE yet
+  std::size_t running() const {
+    auto running = std::size_t{0};
+    for (std::size_t machine = 0; machine < this->count; machine++)
+      running += this->states[machine] != static_cast<std::uint8_t>(State::S_END_MACHINE);
+    return running;
+  }
+
+  // one tick: every machine takes its pending transition, then runs the
+  // action of the state it landed in, as main() does for one Machine
+  void step() {
+    for (std::size_t at = 0; at < this->states.size(); at += LANES) {
+      auto block = this->load(at);
+      block.states = lookup(block.states * static_cast<std::uint8_t>(TRANSITION_COUNT) + block.transitions,
+                            std::make_index_sequence<TABLE_SIZE>{});
+      executeActionSample0(block);
+      executeActionSample1(block);
+      this->store(at, block);
+      if (any(is(block.states, static_cast<std::uint8_t>(State::S_FAILURE))))
+        this->executeActionFailure(at);
+    }
+  }
+
+private:
+  typedef std::uint8_t Bytes __attribute__((vector_size(LANES)));
+  typedef std::int32_t Words __attribute__((vector_size(LANES)));
+
+  static constexpr auto TABLE_SIZE = machineBatch::TABLE_SIZE;
+  static constexpr auto DESTINATIONS = machineBatch::destinations();
+  static constexpr auto COMMON = machineBatch::mostCommon(DESTINATIONS);
+
+  static_assert(TABLE_SIZE <= 256, "a (state, transition) index has to fit in a byte");
+
+  // LANES machines, the loops of machine 4k + g in lane k of loops[g]: that's
+  // where a byte mask reinterpreted as ints has the machine's byte, shifts
+  // turn one into the other
+  struct Block {
+    Bytes states;
+    Bytes transitions;
+    Words loops[4];
+  };
+
+  static std::size_t slot(std::size_t machine) {
+    return machine - machine % LANES + machine % 4 * 4 + machine % LANES / 4;
+  }
+
+  static Bytes load(std::uint8_t const* lanes) {
+    auto bytes = Bytes{};
+    std::memcpy(&bytes, lanes, sizeof(bytes));
+    return bytes;
+  }
+
+  Block load(std::size_t at) const {
+    auto block = Block{};
+    block.states = load(&this->states[at]);
+    block.transitions = load(&this->transitions[at]);
+    std::memcpy(block.loops, &this->loops[at], sizeof(block.loops));
+    return block;
+  }
+
+  void store(std::size_t at, Block const& block) {
+    std::memcpy(&this->states[at], &block.states, sizeof(block.states));
+    std::memcpy(&this->transitions[at], &block.transitions, sizeof(block.transitions));
+    std::memcpy(&this->loops[at], block.loops, sizeof(block.loops));
+  }
+
+  // comparisons give all ones or zeros per lane
+  static Bytes is(Bytes lanes, std::uint8_t value) { return reinterpret_cast<Bytes>(lanes == value); }
+
+  static Bytes select(Bytes mask, Bytes ones, Bytes zeros) { return (ones & mask) | (zeros & ~mask); }
+
+  static bool any(Bytes mask) {
+    std::uint64_t halves[2];
+    std::memcpy(halves, &mask, sizeof(halves));
+    return (halves[0] | halves[1]) != 0;
+  }
+
+  // the lanes of loops[G] out of a byte mask, and back
+  template <int G> static Words widen(Bytes mask) { return (reinterpret_cast<Words>(mask) << (24 - 8 * G)) >> 24; }
+
+  template <int G> static Bytes narrow(Words mask) { return reinterpret_cast<Bytes>((mask & 0xff) << (8 * G)); }
+
+  // only the entries not leading to the most common destination cost a compare
+  template <std::size_t... I> static Bytes lookup(Bytes index, std::index_sequence<I...>) {
+    return COMMON ^ ((is(index, I) & static_cast<std::uint8_t>(DESTINATIONS[I] ^ COMMON)) | ...);
+  }
+
+  static void executeActionSample0(Block& block) {
+    auto in = is(block.states, static_cast<std::uint8_t>(State::S_SAMPLE_0));
+    auto more = narrow<0>(block.loops[0] > 0) | narrow<1>(block.loops[1] > 0) | narrow<2>(block.loops[2] > 0) |
+                narrow<3>(block.loops[3] > 0);
+    auto next = select(more, Bytes{} + static_cast<std::uint8_t>(Transition::T_DEFAULT),
+                       Bytes{} + static_cast<std::uint8_t>(Transition::T_ERROR));
+    block.transitions = select(in, next, block.transitions);
+  }
+
+  static void executeActionSample1(Block& block) {
+    auto in = is(block.states, static_cast<std::uint8_t>(State::S_SAMPLE_1));
+    // -1 where it's in
+    block.loops[0] += widen<0>(in);
+    block.loops[1] += widen<1>(in);
+    block.loops[2] += widen<2>(in);
+    block.loops[3] += widen<3>(in);
+    block.transitions = select(in, Bytes{} + static_cast<std::uint8_t>(Transition::T_DEFAULT), block.transitions);
+  }
+
+  // rare and it prints: one machine at a time, on the stored block
+  void executeActionFailure(std::size_t at) {
+    for (auto machine = at; machine < at + LANES; machine++) {
+      if (this->state(machine) != State::S_FAILURE)
+        continue;
+      auto one = Machine{State::S_FAILURE, this->transition(machine), this->loop(machine)};
+      this->transitions[machine] = static_cast<std::uint8_t>(::executeActionFailure(one));
+      this->loops[slot(machine)] = one.loop;
+    }
+  }
+
+  std::vector<std::uint8_t> states;
+  std::vector<std::uint8_t> transitions;
+  std::vector<int> loops; // see Block
+  std::size_t count = 0;
+};
+
+#endif //__MACHINE_BATCH_HPP__
@@ -0,0 +1,161 @@
+#ifndef __STATE_TABLE_HPP__
+#define __STATE_TABLE_HPP__
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+
+// compile-time checks of a {source, transition, destination} table, each
+// returns the first offending entry or state, NONE when there's none. Entries
+// out of range are only reported by firstOutOfRange(), the others skip them.
+namespace stateTable {
+  static constexpr std::size_t NONE = static_cast<std::size_t>(-1);
+
+  template <std::size_t States, std::size_t Transitions, typename Entry>
+  constexpr bool inRange(Entry const& entry) {
+    return static_cast<std::size_t>(entry.source) < States && static_cast<std::size_t>(entry.destination) < States &&
+           static_cast<std::size_t>(entry.transition) < Transitions;
+  }
+
+  template <std::size_t States, std::size_t Transitions, typename Table>
+  constexpr std::size_t firstOutOfRange(Table const& entries) {
+    for (std::size_t i = 0; i < std::size(entries); i++)
+      if (!inRange<States, Transitions>(entries[i]))
+        return i;
+    return NONE;
+  }
+
+  template <std::size_t States, std::size_t Transitions, typename Table>
+  constexpr std::size_t firstDuplicate(Table const& entries) {
+    auto seen = std::array<bool, States * Transitions>{};
+    for (std::size_t i = 0; i < std::size(entries); i++) {
+      if (!inRange<States, Transitions>(entries[i]))
+        continue;
+      auto at = static_cast<std::size_t>(entries[i].source) * Transitions + static_cast<std::size_t>(entries[i].transition);
+      if (seen[at])
+        return i;
+      seen[at] = true;
+    }
+    return NONE;
+  }
+
+  // breadth-first from `start`
+  template <std::size_t States, std::size_t Transitions, typename Table>
+  constexpr std::size_t firstUnreachable(Table const& entries, std::size_t start) {
+    auto reached = std::array<bool, States>{};
+    auto queue = std::array<std::size_t, States>{};
+    auto head = std::size_t{0};
+    auto tail = std::size_t{0};
+    reached[start] = true;
+    queue[tail++] = start;
+    while (head < tail) {
+      auto state = queue[head++];
+      for (std::size_t i = 0; i < std::size(entries); i++) {
+        auto destination = static_cast<std::size_t>(entries[i].destination);
+        if (inRange<States, Transitions>(entries[i]) && static_cast<std::size_t>(entries[i].source) == state &&
+            !reached[destination]) {
+          reached[destination] = true;
+          queue[tail++] = destination;
+        }
+      }
+    }
+    for (std::size_t state = 0; state < States; state++)
+      if (!reached[state])
+        return state;
+    return NONE;
+  }
+
+  // a state with no way out that isn't one of `finals`
+  template <std::size_t States, std::size_t Transitions, typename Table, std::size_t F>
+  constexpr std::size_t firstDeadEnd(Table const& entries, std::array<std::size_t, F> const& finals) {
+    auto leaves = std::array<bool, States>{};
+    for (std::size_t i = 0; i < std::size(entries); i++)
+      if (inRange<States, Transitions>(entries[i]))
+        leaves[static_cast<std::size_t>(entries[i].source)] = true;
+    for (auto final : finals)
+      leaves[final] = true;
+    for (std::size_t state = 0; state < States; state++)
+      if (!leaves[state])
+        return state;
+    return NONE;
+  }
+
+  template <std::size_t States, std::size_t Transitions, typename State, typename Table>
+  constexpr std::array<State, States * Transitions> destinations(Table const& entries, State fallback) {
+    auto table = std::array<State, States * Transitions>{};
+    for (auto& destination : table)
+      destination = fallback;
+    for (std::size_t i = 0; i < std::size(entries); i++)
+      if (inRange<States, Transitions>(entries[i]))
+        table[static_cast<std::size_t>(entries[i].source) * Transitions + static_cast<std::size_t>(entries[i].transition)] =
+            entries[i].destination;
+    return table;
+  }
+
+  template <std::size_t States, std::size_t Transitions, typename Table>
+  constexpr std::array<bool, States * Transitions> defined(Table const& entries) {
+    auto table = std::array<bool, States * Transitions>{};
+    for (std::size_t i = 0; i < std::size(entries); i++)
+      if (inRange<States, Transitions>(entries[i]))
+        table[static_cast<std::size_t>(entries[i].source) * Transitions + static_cast<std::size_t>(entries[i].transition)] = true;
+    return table;
+  }
+} // namespace stateTable
+
+// A transition table turned into a dense [state][transition] array at compile
+// time: next() is one indexed load, no search, no branch, no I/O. `Entries`
+// is a constexpr array (C or std::array) of {source, transition, destination}
+// like g_transitions, `States`/`Transitions` the number of values of each
+// enum, counted from 0.
+// Compilation fails when the table has:
+//  - an entry out of range,
+//  - two entries for the same (source, transition),
+//  - a state that can't be reached from `Start`,
+//  - a state other than `Finals` without any transition out of it.
+// A (state, transition) pair that isn't in the table leads to `Fallback`,
+// debug builds assert on it.
+template <auto const& Entries, std::size_t States, std::size_t Transitions, auto Start, auto Fallback,
+          auto... Finals>
+class StateTable {
+public:
+  using Entry = std::remove_cv_t<std::remove_reference_t<decltype(Entries[0])>>;
+  using State = decltype(Entry::source);
+  using Transition = decltype(Entry::transition);
+
+  static constexpr std::size_t STATES = States;
+  static constexpr std::size_t TRANSITIONS = Transitions;
+  static constexpr State FALLBACK = Fallback;
+
+  static_assert(static_cast<std::size_t>(Start) < States && static_cast<std::size_t>(Fallback) < States,
+                "Start or Fallback is out of the States range");
+  static_assert(((static_cast<std::size_t>(Finals) < States) && ...), "a final state is out of the States range");
+  static_assert(stateTable::firstOutOfRange<States, Transitions>(Entries) == stateTable::NONE,
+                "a table entry is out of the States/Transitions range");
+  static_assert(stateTable::firstDuplicate<States, Transitions>(Entries) == stateTable::NONE,
+                "two table entries for the same (source, transition)");
+  static_assert(stateTable::firstUnreachable<States, Transitions>(Entries, static_cast<std::size_t>(Start)) ==
+                    stateTable::NONE,
+                "a state can't be reached from Start");
+  static_assert(stateTable::firstDeadEnd<States, Transitions>(
+                    Entries, std::array<std::size_t, sizeof...(Finals)>{static_cast<std::size_t>(Finals)...}) ==
+                    stateTable::NONE,
+                "a state other than the Finals has no transition out of it");
+
+  static constexpr State next(State state, Transition transition) {
+    auto i = static_cast<std::size_t>(state) * Transitions + static_cast<std::size_t>(transition);
+    assert(DEFINED[i]);
+    return DESTINATIONS[i];
+  }
+
+  static constexpr bool defined(State state, Transition transition) {
+    return DEFINED[static_cast<std::size_t>(state) * Transitions + static_cast<std::size_t>(transition)];
+  }
+
+private:
+  static constexpr auto DESTINATIONS = stateTable::destinations<States, Transitions>(Entries, Fallback);
+  static constexpr auto DEFINED = stateTable::defined<States, Transitions>(Entries);
+};
+
+#endif //__STATE_TABLE_HPP__
@@ -0,0 +1,246 @@
+#ifndef __TRANSITION_TRACE_HPP__
+#define __TRANSITION_TRACE_HPP__
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "../Clock/TscClock.hpp"
+
+// Always-on binary trace of state machine transitions: every thread records
+// (TSC timestamp, machine, source, transition, destination) into its own
+// ring of CAPACITY records, the oldest are overwritten. Recording is a TSC
+// read and a few stores, no lock, no read-modify-write, no I/O: about the
+// cost of the TSC read. dump() writes every ring to a file,
+// installCrashHandler() makes a fatal signal do the same;
+// statemachine_tracereplay checks and summarizes such a file. Rings are kept
+// for the whole process, a thread that exits leaves its ring to the next one.
+//
+// File: Header, then per ring a RingHeader and `count` Records, oldest first.
+namespace transitionTrace {
+  static constexpr std::size_t CAPACITY = std::size_t{1} << 16; // records per thread, 1 MiB
+  static constexpr std::size_t MAX_THREADS = 256;               // threads beyond that aren't recorded
+
+  static constexpr char MAGIC[8] = {'S', 'M', 'T', 'R', 'A', 'C', 'E', '1'};
+
+  struct Record {
+    std::uint64_t timestamp; // TscClock::ticks()
+    std::uint32_t machine;
+    std::uint8_t source;
+    std::uint8_t transition;
+    std::uint8_t destination;
+    std::uint8_t reserved;
+  };
+
+  struct Header {
+    char magic[8];
+    std::uint32_t recordSize;
+    std::uint32_t rings;
+    double ticksPerSecond;
+  };
+
+  struct RingHeader {
+    std::uint64_t thread; // the last one that recorded into it
+    std::uint64_t count;
+  };
+
+  static_assert(sizeof(Record) == 16 && sizeof(Header) == 24 && sizeof(RingHeader) == 16, "the file layout");
+
+  namespace detail {
+    // a Record as two words, read while it's written
+    struct Slot {
+      std::atomic<std::uint64_t> words[2];
+    };
+
+    static_assert(sizeof(Slot) == sizeof(Record), "a Slot is written to files as a Record");
+
+    struct Ring {
+      std::atomic<std::uint64_t> head{0};
+      std::atomic<std::uint64_t> thread{0};
+      std::atomic<bool> used{true};
+      Slot slots[CAPACITY];
+    };
+
+    inline std::atomic<Ring*> rings[MAX_THREADS] = {};
+    inline std::atomic<std::size_t> ringCount{0};
+    inline thread_local Ring* local = nullptr; // constant-initialized: no guard on access
+
+    // set by installCrashHandler()
+    inline char crashPath[4096] = {};
+    inline double crashTicksPerSecond = 0;
+
+    // gives the ring back when the thread exits
+    struct Owner {
+      ~Owner() {
+        if (local != nullptr)
+          local->used.store(false, std::memory_order_release);
+        local = nullptr;
+      }
+    };
+
+    inline Ring* attach() {
+      thread_local Owner owner;
+      auto count = std::min(ringCount.load(std::memory_order_acquire), MAX_THREADS);
+      Ring* ring = nullptr;
+      for (std::size_t i = 0; i < count && ring == nullptr; i++) {
+        auto candidate = rings[i].load(std::memory_order_acquire);
+        auto used = false;
+        if (candidate != nullptr && candidate->used.compare_exchange_strong(used, true, std::memory_order_acquire))
+          ring = candidate;
+      }
+      if (ring == nullptr) {
+        auto i = ringCount.fetch_add(1, std::memory_order_acq_rel);
+        if (i >= MAX_THREADS)
+          return nullptr;
+        ring = new Ring{};
+        rings[i].store(ring, std::memory_order_release);
+      }
+      ring->thread.store(static_cast<std::uint64_t>(::syscall(SYS_gettid)), std::memory_order_relaxed);
+      local = ring;
+      return ring;
+    }
+
+    // async-signal-safe
+    inline bool writeAll(int fd, void const* data, std::size_t size) {
+      auto bytes = static_cast<char const*>(data);
+      while (size > 0) {
+        auto written = ::write(fd, bytes, size);
+        if (written == -1 && errno == EINTR)
+          continue;
+        if (written <= 0)
+          return false;
+        bytes += written;
+        size -= static_cast<std::size_t>(written);
+      }
+      return true;
+    }
+
+    inline Header header(double ticksPerSecond) {
+      auto header = Header{};
+      std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+      header.recordSize = sizeof(Record);
+      header.rings = static_cast<std::uint32_t>(std::min(ringCount.load(std::memory_order_acquire), MAX_THREADS));
+      header.ticksPerSecond = ticksPerSecond;
+      return header;
+    }
+
+    // the records as they are, a thread still recording may overwrite the
+    // oldest while they're written: fine for a process that's going down
+    inline bool writeRingInPlace(int fd, Ring const& ring) {
+      auto head = ring.head.load(std::memory_order_acquire);
+      auto count = std::min<std::uint64_t>(head, CAPACITY);
+      auto ringHeader = RingHeader{ring.thread.load(std::memory_order_relaxed), count};
+      auto begin = (head - count) % CAPACITY;
+      auto first = std::min<std::uint64_t>(count, CAPACITY - begin);
+      return writeAll(fd, &ringHeader, sizeof(ringHeader)) &&
+             writeAll(fd, &ring.slots[begin], first * sizeof(Record)) &&
+             writeAll(fd, &ring.slots[0], (count - first) * sizeof(Record));
+    }
+
+    // a copy, without the records overwritten while it was taken
+    inline std::vector<Record> snapshot(Ring const& ring) {
+      auto head = ring.head.load(std::memory_order_acquire);
+      auto begin = head - std::min<std::uint64_t>(head, CAPACITY);
+      auto records = std::vector<Record>{};
+      records.reserve(head - begin);
+      for (auto i = begin; i < head; i++) {
+        auto& slot = ring.slots[i % CAPACITY];
+        std::uint64_t words[2] = {slot.words[0].load(std::memory_order_relaxed),
+                                  slot.words[1].load(std::memory_order_relaxed)};
+        records.emplace_back();
+        std::memcpy(&records.back(), words, sizeof(words));
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      auto now = ring.head.load(std::memory_order_relaxed);
+      // the writer may be storing record `now` already
+      auto overwritten = now + 1 > CAPACITY ? now + 1 - CAPACITY : 0;
+      if (overwritten > begin)
+        records.erase(records.begin(), records.begin() + static_cast<std::ptrdiff_t>(std::min(overwritten, head) - begin));
+      return records;
+    }
+
+    inline void onCrash(int signal) {
+      auto saved = errno;
+      auto fd = ::open(crashPath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+      if (fd != -1) {
+        auto written = header(crashTicksPerSecond);
+        auto ok = writeAll(fd, &written, sizeof(written));
+        for (std::size_t i = 0; ok && i < written.rings; i++) {
+          auto ring = rings[i].load(std::memory_order_acquire);
+          auto empty = RingHeader{};
+          ok = ring != nullptr ? writeRingInPlace(fd, *ring) : writeAll(fd, &empty, sizeof(empty));
+        }
+        ::close(fd);
+      }
+      errno = saved;
+      // SA_RESETHAND put the default action back
+      ::raise(signal);
+    }
+  } // namespace detail
+
+  template <typename State, typename Transition>
+  inline void record(std::uint32_t machine, State source, Transition transition, State destination) {
+    auto ring = detail::local;
+    if (ring == nullptr && (ring = detail::attach()) == nullptr)
+      return;
+    auto written = Record{TscClock::ticks(), machine, static_cast<std::uint8_t>(source),
+                          static_cast<std::uint8_t>(transition), static_cast<std::uint8_t>(destination), 0};
+    std::uint64_t words[2];
+    std::memcpy(words, &written, sizeof(words));
+
+    auto head = ring->head.load(std::memory_order_relaxed);
+    auto& slot = ring->slots[head % CAPACITY];
+    // a snapshot that reads these words also sees head, see detail::snapshot()
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.words[0].store(words[0], std::memory_order_relaxed);
+    slot.words[1].store(words[1], std::memory_order_relaxed);
+    ring->head.store(head + 1, std::memory_order_release);
+  }
+
+  // every ring to `path`, while threads keep recording
+  inline bool dump(std::string const& path) {
+    auto fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1)
+      return false;
+    auto written = detail::header(TscClock::ticksPerSecond());
+    auto ok = detail::writeAll(fd, &written, sizeof(written));
+    for (std::size_t i = 0; ok && i < written.rings; i++) {
+      auto ring = detail::rings[i].load(std::memory_order_acquire);
+      auto records = ring != nullptr ? detail::snapshot(*ring) : std::vector<Record>{};
+      auto ringHeader = RingHeader{ring != nullptr ? ring->thread.load(std::memory_order_relaxed) : 0, records.size()};
+      ok = detail::writeAll(fd, &ringHeader, sizeof(ringHeader)) &&
+           detail::writeAll(fd, records.data(), records.size() * sizeof(Record));
+    }
+    return ::close(fd) == 0 && ok;
+  }
+
+  // SIGSEGV, SIGBUS, SIGFPE, SIGILL and SIGABRT write every ring to `path`,
+  // then take their default action. Calibrates the TSC first (~20ms).
+  inline bool installCrashHandler(std::string const& path) {
+    if (path.size() >= sizeof(detail::crashPath))
+      return false;
+    detail::crashTicksPerSecond = TscClock::ticksPerSecond();
+    std::memcpy(detail::crashPath, path.c_str(), path.size() + 1);
+
+    struct sigaction action = {};
+    action.sa_handler = detail::onCrash;
+    action.sa_flags = SA_RESETHAND;
+    sigemptyset(&action.sa_mask);
+    for (auto signal : {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT}) {
+      if (::sigaction(signal, &action, nullptr) == -1)
+        return false;
+    }
+    return true;
+  }
+} // namespace transitionTrace
+
+#endif //__TRANSITION_TRACE_HPP__
@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "../ScopedTimer/LatencyHistogram.hpp"
+#include "StateMachine1.hpp"
+#include "TransitionTrace.hpp"
+
+// usage: statemachine_tracereplay <trace>
+// replays a TransitionTrace.hpp file against Transitions1: every record has
+// to be a step of the table, every machine has to leave from the state it
+// last went to. Then prints how often each transition was taken and how long
+// machines stayed in each state. Exits with 1 when a check fails.
+//
+// Rings only keep their last records: when one was overwritten, a machine
+// may miss steps recorded before the newest of the overwritten rings' oldest
+// record. Such gaps are counted, not errors.
+
+namespace {
+  using transitionTrace::Record;
+
+  static constexpr std::size_t ERRORS_SHOWN = 10;
+
+  void add(HistogramSnapshot& histogram, std::uint64_t ns) {
+    histogram.counts[HistogramBuckets::indexOf(ns)]++;
+    histogram.count++;
+    histogram.sum += ns;
+    histogram.min = std::min(histogram.min, ns);
+    histogram.max = std::max(histogram.max, ns);
+  }
+
+  bool inRange(Record const& record) {
+    return record.source < STATE_COUNT && record.destination < STATE_COUNT && record.transition < TRANSITION_COUNT;
+  }
+
+  // the step
+  void print(std::ostream& out, Record const& record) {
+    if (inRange(record))
+      out << State(record.source) << " -> " << Transition(record.transition) << " -> " << State(record.destination);
+    else
+      out << int(record.source) << " -> " << int(record.transition) << " -> " << int(record.destination);
+  }
+} // namespace
+
+int main(int argc, char const* argv[]) {
+  if (argc != 2) {
+    std::cerr << "usage: " << argv[0] << " <transition trace>\n";
+    return 2;
+  }
+
+  auto file = std::fopen(argv[1], "rb");
+  if (file == nullptr) {
+    std::cerr << "cannot open " << argv[1] << ": " << std::strerror(errno) << "\n";
+    return 1;
+  }
+
+  auto header = transitionTrace::Header{};
+  if (std::fread(&header, sizeof(header), 1, file) != 1 ||
+      std::memcmp(header.magic, transitionTrace::MAGIC, sizeof(header.magic)) != 0 ||
+      header.recordSize != sizeof(Record)) {
+    std::cerr << argv[1] << " is not a transition trace\n";
+    std::fclose(file);
+    return 1;
+  }
+
+  // a crash dump may be cut short or end in garbage: what was read before is
+  // still replayed
+  auto records = std::vector<Record>{};
+  auto complete = std::uint64_t{0}; // from then on no ring lost anything
+  auto truncated = false;
+  for (std::uint32_t ring = 0; ring < header.rings && !truncated; ring++) {
+    auto ringHeader = transitionTrace::RingHeader{};
+    if (ring == transitionTrace::MAX_THREADS || std::fread(&ringHeader, sizeof(ringHeader), 1, file) != 1 ||
+        ringHeader.count > transitionTrace::CAPACITY) {
+      truncated = true;
+      break;
+    }
+    auto begin = records.size();
+    records.resize(begin + ringHeader.count);
+    auto read = std::fread(&records[begin], sizeof(Record), ringHeader.count, file);
+    records.resize(begin + read);
+    truncated = read != ringHeader.count;
+    // dump() drops the record a thread may be writing
+    if (read > 0 && ringHeader.count + 1 >= transitionTrace::CAPACITY)
+      complete = std::max(complete, records[begin].timestamp);
+  }
+  std::fclose(file);
+  if (truncated)
+    std::cerr << argv[1] << " is truncated, replaying the " << records.size() << " records read\n";
+
+  // each machine's steps in order, whichever thread recorded them
+  std::sort(records.begin(), records.end(), [](Record const& a, Record const& b) {
+    return std::tie(a.machine, a.timestamp) < std::tie(b.machine, b.timestamp);
+  });
+
+  auto toNs = [&header](std::uint64_t ticks) {
+    return static_cast<std::uint64_t>(static_cast<double>(ticks) * 1e9 / header.ticksPerSecond);
+  };
+
+  auto frequencies = std::map<std::tuple<int, int, int>, std::uint64_t>{};
+  auto dwell = std::vector<HistogramSnapshot>(STATE_COUNT);
+  auto machines = std::uint64_t{0};
+  auto gaps = std::uint64_t{0};
+  auto errors = std::vector<std::string>{};
+  auto errorCount = std::uint64_t{0};
+  auto fail = [&](Record const& record, char const* what) {
+    if (errorCount++ < ERRORS_SHOWN) {
+      auto out = std::ostringstream{};
+      out << "machine " << record.machine << " at " << record.timestamp << ": ";
+      print(out, record);
+      out << ": " << what;
+      errors.push_back(out.str());
+    }
+  };
+
+  for (std::size_t i = 0; i < records.size(); i++) {
+    auto const& record = records[i];
+    auto first = i == 0 || records[i - 1].machine != record.machine;
+    machines += first;
+
+    if (!inRange(record)) {
+      fail(record, "out of range");
+      continue;
+    }
+    auto source = State(record.source);
+    auto transition = Transition(record.transition);
+    if (!Transitions1::defined(source, transition)) {
+      fail(record, "not in the table");
+    } else if (Transitions1::next(source, transition) != State(record.destination)) {
+      fail(record, "the table goes elsewhere");
+    }
+    frequencies[{record.source, record.transition, record.destination}]++;
+
+    if (first)
+      continue;
+    auto const& previous = records[i - 1];
+    if (previous.destination != record.source) {
+      if (previous.timestamp < complete)
+        gaps++;
+      else
+        fail(record, "not from the state the machine was in");
+      continue;
+    }
+    add(dwell[record.source], toNs(record.timestamp - previous.timestamp));
+  }
+
+  std::cout << argv[1] << ": " << header.rings << " rings, " << records.size() << " records, " << machines
+            << " machines\n";
+
+  auto byCount = std::vector<std::pair<std::uint64_t, std::tuple<int, int, int>>>{};
+  for (auto const& [step, count] : frequencies)
+    byCount.emplace_back(count, step);
+  std::sort(byCount.begin(), byCount.end(), [](auto const& a, auto const& b) { return a.first > b.first; });
+
+  std::cout << "\ntransitions\n";
+  for (auto const& [count, step] : byCount) {
+    auto record = Record{0, 0, static_cast<std::uint8_t>(std::get<0>(step)), static_cast<std::uint8_t>(std::get<1>(step)),
+                         static_cast<std::uint8_t>(std::get<2>(step)), 0};
+    std::cout << std::setw(12) << count << std::setw(8) << std::fixed << std::setprecision(2)
+              << 100.0 * static_cast<double>(count) / static_cast<double>(records.size()) << "%  ";
+    print(std::cout, record);
+    std::cout << "\n";
+  }
+
+  std::cout << "\ndwell time (ns)\n";
+  for (std::size_t state = 0; state < STATE_COUNT; state++) {
+    auto const& histogram = dwell[state];
+    if (histogram.count == 0)
+      continue;
+    std::cout << State(state) << ": " << histogram.count << " stays, min " << histogram.min << ", p50 "
+              << histogram.percentile(0.5) << ", p90 " << histogram.percentile(0.9) << ", p99 "
+              << histogram.percentile(0.99) << ", max " << histogram.max << "\n";
+    // stays from 2^k ns on
+    auto buckets = std::vector<std::uint64_t>(64);
+    for (std::size_t i = 0; i < HistogramBuckets::COUNT; i++) {
+      auto low = HistogramBuckets::lowerBound(i);
+      buckets[low == 0 ? 0 : 63 - __builtin_clzll(low)] += histogram.counts[i];
+    }
+    auto most = *std::max_element(buckets.begin(), buckets.end());
+    for (std::size_t bucket = 0; bucket < buckets.size(); bucket++) {
+      if (buckets[bucket] == 0)
+        continue;
+      std::cout << std::setw(14) << (std::uint64_t{1} << bucket) << std::setw(12) << buckets[bucket] << " "
+                << std::string(static_cast<std::size_t>(std::max<std::uint64_t>(1, 40 * buckets[bucket] / most)), '#') << "\n";
+    }
+  }
+
+  if (gaps != 0)
+    std::cout << "\n" << gaps << " gaps from overwritten records\n";
+  if (errorCount == 0)
+    return 0;
+
+  std::cerr << "\n" << errorCount << " records don't replay:\n";
+  for (auto const& error : errors)
+    std::cerr << "  " << error << "\n";
+  if (errorCount > errors.size())
+    std::cerr << "  ...\n";
+  return 1;
+}
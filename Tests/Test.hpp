@@ -0,0 +1,50 @@
+#ifndef __TEST_HPP__
+#define __TEST_HPP__
+
+#include <iostream>
+
+// Minimal checks shared by the per-module test programs, see CMakeLists.txt.
+// A failed CHECK prints where and what, the program goes on and main()
+// returns test::failures(), which ctest reports.
+//
+//     int main() {
+//         CHECK(Transitions1::defined(State::S_SAMPLE_0, Transition::T_ERROR));
+//         CHECK_EQ(Transitions1::next(State::S_FAILURE, Transition::T_DEFAULT), State::S_END_MACHINE);
+//         return test::failures();
+//     }
+//
+// Release builds drop assert(), these stay.
+namespace test {
+    inline int& failureCount() {
+        static int count = 0;
+        return count;
+    }
+
+    inline bool check(bool ok, char const* expression, char const* file, int line) {
+        if (!ok) {
+            std::cerr << file << ":" << line << ": CHECK(" << expression << ") failed\n";
+            failureCount()++;
+        }
+        return ok;
+    }
+
+    template <typename A, typename B>
+        bool checkEqual(A const& a, B const& b, char const* expressions, char const* file, int line) {
+            if (a == b)
+                return true;
+            std::cerr << file << ":" << line << ": CHECK_EQ(" << expressions << ") failed: " << a << " != " << b << "\n";
+            failureCount()++;
+            return false;
+        }
+
+    inline int failures() {
+        if (failureCount() != 0)
+            std::cerr << failureCount() << " checks failed\n";
+        return failureCount() == 0 ? 0 : 1;
+    }
+}
+
+#define CHECK(...) test::check(static_cast<bool>(__VA_ARGS__), #__VA_ARGS__, __FILE__, __LINE__)
+#define CHECK_EQ(a, b) test::checkEqual((a), (b), #a ", " #b, __FILE__, __LINE__)
+
+#endif //__TEST_HPP__
@@ -0,0 +1,125 @@
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "Test.hpp"
+#include "../ErrorHandling/Expected.hpp"
+
+namespace {
+  Expected<int> parsePort(int port) {
+    if (port <= 0 || port > 65535)
+      return MakeUnexpected(ErrorCode::EC_INVALID_INPUT, "port", port);
+    return port;
+  }
+
+  Expected<std::string> name(bool ok) {
+    if (!ok)
+      return ErrorCode::EC_INVALID_INPUT;
+    return std::string(40, 'n'); // past the small string buffer
+  }
+
+  Expected<void> check(bool ok) {
+    if (!ok)
+      return MakeUnexpected(ErrorCode::EC_INVALID_INPUT, 1.5, true);
+    return ErrorCode::NO_ERROR;
+  }
+
+  void values() {
+    auto port = parsePort(80);
+    if (CHECK(port.getError() == ErrorCode::NO_ERROR))
+      CHECK_EQ(port.get(), 80);
+
+    // E{} is success with a value-initialized T
+    auto zero = Expected<int>{ErrorCode::NO_ERROR};
+    if (CHECK(zero.getError() == ErrorCode::NO_ERROR))
+      CHECK_EQ(zero.get(), 0);
+  }
+
+  void errors() {
+    auto port = parsePort(70000);
+    CHECK(port.getError() == ErrorCode::EC_INVALID_INPUT);
+    auto message = port.message();
+    CHECK(message.find("EC_INVALID_INPUT [input] at ") == 0);
+    CHECK(message.find("in parsePort") != std::string::npos);
+    CHECK(message.find(": port 70000") != std::string::npos);
+
+    // no context without MakeUnexpected
+    auto plain = name(false);
+    CHECK(plain.getError() == ErrorCode::EC_INVALID_INPUT);
+    CHECK_EQ(plain.message(), "EC_INVALID_INPUT [input]");
+  }
+
+  void contextOverwritten() {
+    auto port = parsePort(-1);
+    for (std::size_t i = 0; i < ErrorContext::SLOTS; i++)
+      (void)parsePort(0).getError();
+    CHECK(port.getError() == ErrorCode::EC_INVALID_INPUT);
+    CHECK(port.message().find("overwritten") != std::string::npos);
+  }
+
+  // two fresh threads: counted per thread, their first sequences would be the same
+  void foreignContext() {
+    auto theirs = Expected<int>{0};
+    std::thread{[&theirs] { theirs = parsePort(-7); }}.join();
+    std::thread{[&theirs] {
+      auto mine = parsePort(1234567);
+      CHECK(mine.getError() == ErrorCode::EC_INVALID_INPUT);
+      CHECK(mine.message().find(": port 1234567") != std::string::npos);
+      CHECK(theirs.getError() == ErrorCode::EC_INVALID_INPUT);
+      CHECK(theirs.message().find("port") == std::string::npos);
+      CHECK(theirs.message().find("another thread") != std::string::npos);
+    }}.join();
+  }
+
+  void nonTrivialValue() {
+    auto value = name(true);
+    auto error = name(false);
+    (void)value.getError();
+    (void)error.getError();
+
+    // value to value, error to value, value to error, and back
+    auto copy = value;
+    if (CHECK(copy.getError() == ErrorCode::NO_ERROR))
+      CHECK_EQ(copy.get(), std::string(40, 'n'));
+    auto moved = std::move(copy);
+    if (CHECK(moved.getError() == ErrorCode::NO_ERROR))
+      CHECK_EQ(moved.get(), std::string(40, 'n'));
+
+    auto target = error;
+    CHECK(target.getError() == ErrorCode::EC_INVALID_INPUT);
+    target = value;
+    if (CHECK(target.getError() == ErrorCode::NO_ERROR))
+      CHECK_EQ(target.get(), std::string(40, 'n'));
+    target = error;
+    CHECK(target.getError() == ErrorCode::EC_INVALID_INPUT);
+    target = std::move(moved);
+    if (CHECK(target.getError() == ErrorCode::NO_ERROR))
+      CHECK_EQ(target.get(), std::string(40, 'n'));
+  }
+
+  void voidResult() {
+    CHECK(check(true).getError() == ErrorCode::NO_ERROR);
+    auto failed = check(false);
+    CHECK(failed.getError() == ErrorCode::EC_INVALID_INPUT);
+    CHECK(failed.message().find(": 1.5 true") != std::string::npos);
+  }
+
+#ifdef NDEBUG
+  // returned in registers
+  static_assert(std::is_trivially_copyable<Expected<int>>::value);
+  static_assert(sizeof(Expected<int>) == 2 * sizeof(int));
+  static_assert(std::is_trivially_copyable<Expected<void>>::value);
+  static_assert(!std::is_trivially_copyable<Expected<std::string>>::value);
+#endif
+} // namespace
+
+int main() {
+  values();
+  errors();
+  contextOverwritten();
+  foreignContext();
+  nonTrivialValue();
+  voidResult();
+  return test::failures();
+}
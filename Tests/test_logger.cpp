@@ -0,0 +1,94 @@
+#include <cerrno>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Test.hpp"
+#include "BinaryLogger.h"
+#include "Logger.h"
+
+namespace {
+    // every line written, in order
+    struct Capture : log::Sink {
+        std::vector<std::string> lines;
+
+        void write(char const* data, std::size_t size) override {
+            auto text = std::string{data, size};
+            for (std::size_t begin = 0, end; begin < text.size(); begin = end + 1) {
+                end = text.find('\n', begin);
+                if (end == std::string::npos)
+                    end = text.size();
+                this->lines.push_back(text.substr(begin, end - begin));
+            }
+        }
+    };
+
+    // what follows "I: ", "E: " & co
+    std::string message(std::string const& line) {
+        auto at = line.find(": ");
+        return at == std::string::npos ? line : line.substr(at + 2);
+    }
+
+    struct Node {
+        int depth;
+    };
+
+    // formats again while being formatted, as a user operator<< may
+    std::ostream& operator<<(std::ostream& out, Node const& node) {
+        out << "(" << node.depth;
+        if (node.depth > 0)
+            out << log::join(" ", Node{node.depth - 1});
+        return out << ")";
+    }
+
+    void asyncTruncation() {
+        auto capture = Capture{};
+        log::setSink(&capture);
+        log::async::start();
+        auto exact = std::string(log::async::Record::TEXT_SIZE, 'a');
+        log::info(exact);
+        log::info(std::string(log::async::Record::TEXT_SIZE + 1, 'b'));
+        log::async::stop();
+        log::setSink(nullptr);
+
+        if (CHECK_EQ(capture.lines.size(), 2u)) {
+            CHECK_EQ(message(capture.lines[0]), exact);
+            CHECK_EQ(message(capture.lines[1]), std::string(log::async::Record::TEXT_SIZE - 3, 'b') + "...");
+        }
+    }
+
+    void binaryTextGoesToSink() {
+        auto capture = Capture{};
+        log::setSink(&capture);
+        LOG_BIN_INFO("sync {}", 1);
+        log::async::start();
+        errno = ENOENT;
+        LOG_BIN_ERROR("async {}", 2);
+        log::async::stop();
+        log::setSink(nullptr);
+
+        if (CHECK_EQ(capture.lines.size(), 2u)) {
+            CHECK_EQ(message(capture.lines[0]), "sync 1");
+            CHECK(capture.lines[1].find("async 2 [errno: 2 - ") != std::string::npos);
+        }
+    }
+
+    void nestedFormatting() {
+        CHECK_EQ(log::join(" ", 1, Node{3}, "end"), "1 (3(2(1(0)))) end");
+    }
+
+    void joinExactSize() {
+        // join() into a std::string starts with 256 bytes
+        auto text = std::string(256, 'c');
+        CHECK_EQ(log::join("", text), text);
+        CHECK_EQ(log::join("", text, "d"), text + "d");
+    }
+}
+
+int main() {
+    asyncTruncation();
+    binaryTextGoesToSink();
+    nestedFormatting();
+    joinExactSize();
+    return test::failures();
+}
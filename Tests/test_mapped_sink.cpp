@@ -0,0 +1,150 @@
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "Test.hpp"
+#include "MappedSink.h"
+
+namespace {
+    namespace fs = std::filesystem;
+
+    // the lines of one segment file, in record order
+    std::vector<std::string> readSegment(fs::path const& path) {
+        auto file = std::ifstream{path, std::ios::binary};
+        auto data = std::string{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+        auto lines = std::vector<std::string>{};
+        if (!CHECK(data.size() >= log::MappedSink::HEADER_SIZE) ||
+                !CHECK(std::memcmp(data.data(), log::MappedSink::MAGIC, sizeof(log::MappedSink::MAGIC)) == 0))
+            return lines;
+
+        auto offset = log::MappedSink::HEADER_SIZE;
+        while (offset + log::MappedSink::RECORD_HEADER_SIZE <= data.size()) {
+            auto marker = std::uint32_t{};
+            auto length = std::uint32_t{};
+            std::memcpy(&marker, &data[offset], sizeof(marker));
+            std::memcpy(&length, &data[offset + 4], sizeof(length));
+            if (marker != log::MappedSink::RECORD_MARKER)
+                break;
+            lines.emplace_back(&data[offset + log::MappedSink::RECORD_HEADER_SIZE], length);
+            offset += (log::MappedSink::RECORD_HEADER_SIZE + length + 7) & ~std::size_t{7};
+        }
+        return lines;
+    }
+
+    // every segment that is still there, oldest first
+    std::vector<std::string> readAll(std::string const& directory, std::size_t& segments) {
+        auto lines = std::vector<std::string>{};
+        segments = 0;
+        for (std::uint64_t sequence = 1; sequence < 1000; sequence++) {
+            auto path = log::MappedSink::segmentPath(directory, "test", sequence);
+            if (!fs::exists(path))
+                continue;
+            segments++;
+            auto segment = readSegment(path);
+            lines.insert(lines.end(), segment.begin(), segment.end());
+        }
+        return lines;
+    }
+
+    std::string line(int i) {
+        auto text = std::to_string(i);
+        return "line " + std::string(6 - text.size(), '0') + text + std::string(80, '.');
+    }
+
+    std::string makeDirectory() {
+        char name[] = "/tmp/mapped_sink_XXXXXX";
+        return ::mkdtemp(name) != nullptr ? name : "";
+    }
+
+    void rotatesAndKeepsOrder() {
+        auto directory = makeDirectory();
+        if (!CHECK(!directory.empty()))
+            return;
+        {
+            auto sink = log::MappedSink{{directory, "test", 4096, 0}};
+            CHECK(sink.isOpen());
+            for (int i = 0; i < 200; i++) {
+                auto text = line(i);
+                sink.write(text.data(), text.size());
+            }
+            CHECK_EQ(sink.dropped(), 0u);
+        }
+
+        auto segments = std::size_t{0};
+        auto lines = readAll(directory, segments);
+        CHECK(segments > 3);
+        if (CHECK_EQ(lines.size(), 200u))
+            for (int i = 0; i < 200; i++)
+                CHECK_EQ(lines[i], line(i));
+        fs::remove_all(directory);
+    }
+
+    void deletesOldSegments() {
+        auto directory = makeDirectory();
+        if (!CHECK(!directory.empty()))
+            return;
+        {
+            auto sink = log::MappedSink{{directory, "test", 4096, 3}};
+            for (int i = 0; i < 200; i++) {
+                auto text = line(i);
+                sink.write(text.data(), text.size());
+            }
+        }
+
+        auto segments = std::size_t{0};
+        auto lines = readAll(directory, segments);
+        CHECK_EQ(segments, 3u);
+        // the newest lines, none missing
+        if (CHECK(!lines.empty()) && CHECK(lines.size() < 200u))
+            for (std::size_t i = 0; i < lines.size(); i++)
+                CHECK_EQ(lines[i], line(static_cast<int>(200 - lines.size() + i)));
+        fs::remove_all(directory);
+    }
+
+    void resumesWhenTheDirectoryIsBack() {
+        auto directory = makeDirectory();
+        if (!CHECK(!directory.empty()))
+            return;
+        auto sink = log::MappedSink{{directory, "test", 4096, 0}};
+        auto i = 0;
+        for (; i < 10; i++) {
+            auto text = line(i);
+            sink.write(text.data(), text.size());
+        }
+
+        // the current segment fills up, the next can't be opened
+        fs::remove_all(directory);
+        for (; i < 100; i++) {
+            auto text = line(i);
+            sink.write(text.data(), text.size());
+        }
+        auto dropped = sink.dropped();
+        CHECK(dropped > 0u);
+
+        fs::create_directory(directory);
+        for (; i < 110; i++) {
+            auto text = line(i);
+            sink.write(text.data(), text.size());
+        }
+        CHECK_EQ(sink.dropped(), dropped);
+
+        auto segments = std::size_t{0};
+        auto lines = readAll(directory, segments);
+        CHECK_EQ(segments, 1u);
+        if (CHECK_EQ(lines.size(), 10u))
+            CHECK_EQ(lines.back(), line(109));
+        fs::remove_all(directory);
+    }
+}
+
+int main() {
+    rotatesAndKeepsOrder();
+    deletesOldSegments();
+    resumesWhenTheDirectoryIsBack();
+    return test::failures();
+}
@@ -0,0 +1,126 @@
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "Test.hpp"
+#include "../StateMachine/Executor.hpp"
+#include "../StateMachine/MachineBatch.hpp"
+#include "../StateMachine/StateMachine1.hpp"
+
+namespace {
+  // compiled in, checked by the compiler
+  static_assert(Transitions1::next(State::S_START_MACHINE, Transition::T_DEFAULT) == State::S_SAMPLE_0);
+  static_assert(Transitions1::next(State::S_SAMPLE_0, Transition::T_ERROR) == State::S_FAILURE);
+  static_assert(Transitions1::next(State::S_FAILURE, Transition::T_DEFAULT) == State::S_END_MACHINE);
+  static_assert(Transitions1::defined(State::S_SAMPLE_1, Transition::T_DEFAULT));
+  static_assert(!Transitions1::defined(State::S_SAMPLE_1, Transition::T_ERROR));
+  static_assert(!Transitions1::defined(State::S_END_MACHINE, Transition::T_DEFAULT));
+#ifdef NDEBUG
+  // debug builds assert instead
+  static_assert(Transitions1::next(State::S_SAMPLE_1, Transition::T_ERROR) == Transitions1::FALLBACK);
+#endif
+
+  // one tick of one machine, as main() does it
+  void step(Machine& machine) {
+    if (machine.state == State::S_END_MACHINE)
+      return;
+    machine.state = Transitions1::next(machine.state, machine.transition);
+    switch (machine.state) {
+    case State::S_SAMPLE_0:
+      machine.transition = executeActionSample0(machine);
+      break;
+    case State::S_SAMPLE_1:
+      machine.transition = executeActionSample1(machine);
+      break;
+    case State::S_FAILURE:
+      machine.transition = executeActionFailure(machine);
+      break;
+    default:
+      break;
+    }
+  }
+
+  // every entry of g_transitions, nothing else
+  void table() {
+    auto entries = std::size_t{0};
+    for (std::size_t s = 0; s < STATE_COUNT; s++) {
+      for (std::size_t t = 0; t < TRANSITION_COUNT; t++) {
+        auto state = State(s);
+        auto transition = Transition(t);
+        auto found = false;
+        for (auto const& entry : g_transitions) {
+          if (entry.source == state && entry.transition == transition) {
+            found = true;
+            CHECK(Transitions1::next(state, transition) == entry.destination);
+          }
+        }
+        CHECK_EQ(Transitions1::defined(state, transition), found);
+        entries += found;
+      }
+    }
+    CHECK_EQ(entries, std::size(g_transitions));
+  }
+
+  void batchMatchesMachines() {
+    // machines at every point of their run, more than a block
+    auto machines = std::vector<Machine>{};
+    auto batch = MachineBatch{};
+    for (int i = 0; i < 37; i++) {
+      auto machine = Machine{State::S_START_MACHINE, Transition::T_DEFAULT, i % 7};
+      for (int ticks = 0; ticks < i % 5; ticks++)
+        step(machine);
+      machines.push_back(machine);
+      batch.add(machine);
+    }
+
+    for (int tick = 0; tick < 20; tick++) {
+      for (auto& machine : machines)
+        step(machine);
+      batch.step();
+      for (std::size_t i = 0; i < machines.size(); i++) {
+        CHECK(batch.state(i) == machines[i].state);
+        CHECK(batch.transition(i) == machines[i].transition);
+        CHECK_EQ(batch.loop(i), machines[i].loop);
+      }
+    }
+    CHECK_EQ(batch.running(), 0u);
+  }
+
+  void executorDrains() {
+    auto executor = Executor{4};
+    auto expected = std::uint64_t{0};
+    for (int i = 0; i < 200; i++) {
+      auto loop = i % 3 == 0 ? 500 : i % 11;
+      executor.add(Machine{State::S_START_MACHINE, Transition::T_DEFAULT, loop});
+      // the start, two steps per loop, the error and the end
+      expected += 2 * loop + 3;
+    }
+    for (std::size_t i = 0; i < executor.size(); i++)
+      executor.post(i, Transition::T_DEFAULT);
+    executor.wait();
+
+    auto events = std::uint64_t{0};
+    for (std::size_t worker = 0; worker < executor.workerCount(); worker++)
+      events += executor.counters(worker).events;
+    CHECK_EQ(events, expected);
+    for (std::size_t i = 0; i < executor.size(); i++) {
+      CHECK(executor.state(i) == State::S_END_MACHINE);
+      CHECK_EQ(executor.loop(i), 0);
+    }
+
+    // ended machines drop what they get
+    executor.post(0, Transition::T_DEFAULT);
+    executor.wait();
+    CHECK(executor.state(0) == State::S_END_MACHINE);
+  }
+} // namespace
+
+int main() {
+  // the failure action prints, from every worker
+  if (std::freopen("/dev/null", "w", stdout) == nullptr)
+    return 1;
+  table();
+  batchMatchesMachines();
+  executorDrains();
+  return test::failures();
+}